@@ -1,5 +1,6 @@
 #include <chrono>
 #include <cstring>
+#include <ctime>
 #include <exception>
 #include <iostream>
 #include <thread>
@@ -7,7 +8,11 @@
 #include <unistd.h>
 
 #include "cairo_objects.hh"
+#include "canvas_uploader.hh"
 #include "display.hh"
+#include "presentation_scheduler.hh"
+#include "text_cache.hh"
+#include "text_renderer.hh"
 
 using namespace std;
 using namespace std::chrono;
@@ -17,7 +22,6 @@ void program_body()
   VideoDisplay display { 1920, 1080, false }; // fullscreen window @ 1920x1080 luma resolution
 
   Cairo cairo { 1920, 1080 };
-  Pango pango { cairo };
 
   /* open the PNG */
   PNGSurface png_image { "/home/keithw/stipple-fullsize.png" };
@@ -27,7 +31,7 @@ void program_body()
   cairo_identity_matrix( cairo );
   cairo_rectangle( cairo, 500, 500, 100, 100 );
   cairo_set_source_rgba( cairo, 0, 0.9, 0, 0.5 );
-  cairo_fill( cairo );
+  cairo.fill();
 
   /* draw the PNG */
   cairo_identity_matrix( cairo );
@@ -36,49 +40,69 @@ void program_body()
   cairo_device_to_user( cairo, &center_x, &center_y );
   cairo_translate( cairo, center_x, center_y );
   cairo_set_source_surface( cairo, png_image, 0, 0 );
-  cairo_paint( cairo );
+  cairo.paint();
+
+  /* convert and upload the video canvas once; after that, only what gets redrawn */
+  CanvasUploader canvas { cairo };
+
+  /* text goes on a transparent canvas that the display blends over the video in its
+     shader, so it skips the Y'CbCr conversion and keeps full-resolution colour edges */
+  Cairo labels { 1920, 1080, CAIRO_FORMAT_ARGB32 };
+  TextureBGRA labels_texture { labels.width(), labels.height() };
 
-  /* draw some text */
   Pango::Font myfont { "Times New Roman, 80" };
-  Pango::Text mystring { cairo, pango, myfont, "Hello, world, Brooke, and Luke." };
-  mystring.draw_centered_at( cairo, 960, 540 );
-  cairo_set_source_rgba( cairo, 1, 0, 0, 1 );
-  cairo_fill( cairo );
-
-  /* finish and copy to YUV raster */
-  cairo.flush();
-
-  unsigned int stride = cairo.stride();
-  Raster420 yuv_raster { 1920, 1080 };
-  for ( unsigned int y = 0; y < 1080; y++ ) {
-    for ( unsigned int x = 0; x < 1920; x++ ) {
-      const float red = cairo.pixels()[y * stride + 2 + ( x * 4 )] / 255.0;
-      const float green = cairo.pixels()[y * stride + 1 + ( x * 4 )] / 255.0;
-      const float blue = cairo.pixels()[y * stride + 0 + ( x * 4 )] / 255.0;
-
-      const float Ey = 0.7154 * green + 0.0721 * blue + 0.2125 * red;
-      const float Epb = -0.386 * green + 0.5000 * blue - 0.115 * red;
-      const float Epr = -0.454 * green - 0.046 * blue + 0.500 * red;
-
-      const uint8_t Y = ( 219 * Ey ) + 16;
-      const uint8_t Cb = ( 224 * Epb ) + 128;
-      const uint8_t Cr = ( 224 * Epr ) + 128;
-
-      yuv_raster.Y.at( x, y ) = Y;
-      if ( ( x % 2 ) == 0 and ( y % 2 ) == 0 ) {
-        yuv_raster.Cb.at( x / 2, y / 2 ) = Cb;
-        yuv_raster.Cr.at( x / 2, y / 2 ) = Cr;
-      }
-    }
-  }
+  TextCache text_cache;
+  const auto mystring = text_cache.get( myfont, "Hello, world, Brooke, and Luke." );
+  mystring->draw_centered_at( labels, 960, 540 );
+  cairo_set_source_rgba( labels, 1, 0, 0, 1 );
+  labels.fill();
 
-  Texture420 texture { yuv_raster };
+  /* a wall clock drawn into the labels, so each second touches only a few tiles */
+  const Pango::Font wall_clock_font { "Sans, 40" };
+  time_t wall_clock_shown = 0;
 
   float x = 0;
   float y = 0;
 
+  /* a clock that changes every frame, drawn on the GPU from cached glyphs */
+  TextRenderer overlay;
+  const Pango::Font clock_font { "Sans Bold, 40" };
+  const auto start_time = steady_clock::now();
+
+  /* redraw once per refresh, sleeping in between, rather than as fast as the loop goes */
+  display.window().set_swap_interval( 1 );
+  PresentationScheduler scheduler { display };
+
   while ( true ) {
-    display.draw( texture );
+    scheduler.push( { steady_clock::now(), 0 } );
+    scheduler.next();
+
+    const time_t now = time( nullptr );
+    if ( now != wall_clock_shown ) {
+      char hhmmss[16];
+      strftime( hhmmss, sizeof( hhmmss ), "%H:%M:%S", localtime( &now ) );
+
+      /* replace the old time, and its translucent backing, outright */
+      cairo_identity_matrix( labels );
+      cairo_rectangle( labels, 1600, 40, 280, 80 );
+      cairo_set_operator( labels, CAIRO_OPERATOR_SOURCE );
+      cairo_set_source_rgba( labels, 0, 0, 0, 0.6 );
+      labels.fill();
+      cairo_set_operator( labels, CAIRO_OPERATOR_OVER );
+
+      text_cache.get( wall_clock_font, hhmmss )->draw_centered_at( labels, 1740, 80 );
+      cairo_set_source_rgba( labels, 1, 1, 1, 1 );
+      labels.fill();
+
+      upload_damage( labels, labels_texture, VideoDisplay::OVERLAY_TEXTURE_UNIT );
+      wall_clock_shown = now;
+    }
+
+    const double seconds_elapsed = duration<double>( steady_clock::now() - start_time ).count();
+    auto clock = overlay.layout( clock_font, to_string( seconds_elapsed ) );
+    overlay.draw( clock, 60, 60, { 1, 1, 0, 0.9 } );
+
+    display.draw( canvas.texture(), &labels_texture, &overlay );
     display.set_test_uniform( x, y );
     x += 1.5;
     y += 0.666;
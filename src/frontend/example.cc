@@ -4,6 +4,9 @@
 #include <iostream>
 
 #include "display.hh"
+#include "frame_cache.hh"
+#include "presentation_scheduler.hh"
+#include "thread_pool.hh"
 
 using namespace std;
 using namespace std::chrono;
@@ -12,50 +15,60 @@ void program_body()
 {
   VideoDisplay display { 1920, 1080, true }; // fullscreen window @ 1920x1080 luma resolution
   display.window().hide_cursor( true );
-  display.window().set_swap_interval( 0 ); // wait for vertical retrace before swapping buffer
+  display.window().set_swap_interval( 1 ); // wait for vertical retrace before swapping buffer
 
   /* all white (235 = max luma in typical Y'CbCr colorspace) */
   Raster420 white { 1920, 1080 };
-  memset( white.Y.mutable_pixels(), 235, white.Y.width() * white.Y.height() );
-  Texture420 white_texture { white };
+  parallel_for_bands( white.Y, [&]( const unsigned int first_row, const unsigned int end_row ) {
+    memset( white.Y.mutable_row( first_row ), 235, ( end_row - first_row ) * white.Y.stride() );
+  } );
 
   /* left half white */
   Raster420 left_white { 1920, 1080 };
 
-  for ( unsigned int y = 0; y < left_white.Y.height(); y++ ) {
-    for ( unsigned int x = 0; x < left_white.Y.width(); x++ ) {
-      const uint8_t color = ( x < left_white.Y.width() / 2 ) ? 235 : 16;
-      left_white.Y.at( x, y ) = color;
+  parallel_for_bands( left_white.Y, [&]( const unsigned int first_row, const unsigned int end_row ) {
+    for ( unsigned int y = first_row; y < end_row; y++ ) {
+      for ( unsigned int x = 0; x < left_white.Y.width(); x++ ) {
+        const uint8_t color = ( x < left_white.Y.width() / 2 ) ? 235 : 16;
+        left_white.Y.at( x, y ) = color;
+      }
     }
-  }
-
-  Texture420 left_white_texture { left_white };
+  } );
 
   /* all black (16 = min luma in typical Y'CbCr colorspace) */
   Raster420 black { 1920, 1080 };
-  memset( black.Y.mutable_pixels(), 16, black.Y.width() * black.Y.height() );
-  Texture420 black_texture { black };
-
-  /* alternate black and white */
-  unsigned int frame_count = 0;
-
-  const auto start_time = steady_clock::now();
-
-  while ( true ) {
-    display.draw( left_white_texture );
-    frame_count++;
-    display.draw( white_texture );
-    frame_count++;
-    display.draw( black_texture );
-    frame_count++;
-
-    if ( frame_count % 480 == 0 ) {
-      const auto now = steady_clock::now();
+  parallel_for_bands( black.Y, [&]( const unsigned int first_row, const unsigned int end_row ) {
+    memset( black.Y.mutable_row( first_row ), 16, ( end_row - first_row ) * black.Y.stride() );
+  } );
+
+  /* uploaded on first use, and resident from then on */
+  FrameCache frames { 64 << 20 };
+  const Raster420* const sources[] = { &left_white, &white, &black };
+
+  /* alternate black and white, a new frame due every refresh */
+  display.print_statistics_every( 480 );
+  PresentationScheduler scheduler { display };
+  auto next_due = PresentationScheduler::Clock::now();
+  uint64_t frames_queued = 0;
+
+  for ( uint64_t frame_number = 0;; frame_number++ ) {
+    while ( scheduler.push( { next_due, frames_queued % 3 } ) ) {
+      frames_queued++;
+      next_due += duration_cast<PresentationScheduler::Clock::duration>( scheduler.refresh_period() );
+    }
 
-      const auto ms_elapsed = duration_cast<milliseconds>( now - start_time ).count();
+    const auto frame = scheduler.next();
+    if ( frame ) {
+      const uint64_t id = frame->id;
+      display.draw( frames.get( id, [&] { return sources[id]->view(); } ) );
+    }
 
-      cout << "Drew " << frame_count << " frames in " << ms_elapsed
-           << " milliseconds = " << 1000.0 * double( frame_count ) / ms_elapsed << " frames per second.\n";
+    if ( frame_number == 2 ) {
+      cout << "Frames resident: " << memory_usage_summary() << "\n";
+    }
+    if ( frame_number % 480 == 479 ) {
+      cout << frames.summary_line() << "\n";
+      cout << scheduler.summary_line() << "\n";
     }
   }
 }
@@ -0,0 +1,219 @@
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+
+#include "canvas_uploader.hh"
+#include "display.hh"
+
+using namespace std;
+using namespace std::chrono;
+
+/* does the pixel at (x, y) (counting from the bottom row) have the given color, give or take rounding? */
+bool pixel_is( const vector<uint8_t>& rgba,
+               const unsigned int width,
+               const unsigned int x,
+               const unsigned int y,
+               const array<int, 3>& color )
+{
+  const uint8_t* pixel = &rgba.at( 4 * ( size_t( y ) * width + x ) );
+  for ( unsigned int channel = 0; channel < 3; channel++ ) {
+    if ( abs( pixel[channel] - color[channel] ) > 2 ) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool pixel_is( const vector<uint8_t>& rgba,
+               const unsigned int width,
+               const unsigned int x,
+               const unsigned int y,
+               const int level )
+{
+  return pixel_is( rgba, width, x, y, { level, level, level } );
+}
+
+void program_body( const unsigned int width, const unsigned int height, const unsigned int seconds_to_run )
+{
+  VideoDisplay display { width, height, DisplayMode::Offscreen };
+  cout << ProgramCache::shared().summary_line() << "\n";
+
+  /* left half white, right half black */
+  Raster420 split { width, height };
+  for ( unsigned int y = 0; y < height; y++ ) {
+    for ( unsigned int x = 0; x < width; x++ ) {
+      split.Y.at( x, y ) = ( x < width / 2 ) ? 235 : 16;
+    }
+  }
+  Texture420 split_texture { split };
+
+  cout << "Rendering " << width << "x" << height << " offscreen for " << seconds_to_run << " s\n";
+
+  const auto start_time = steady_clock::now();
+  while ( steady_clock::now() - start_time < seconds( seconds_to_run ) ) {
+    for ( unsigned int i = 0; i < 16; i++ ) {
+      display.draw( split_texture );
+    }
+  }
+
+  const FrameStatistics& statistics = display.statistics();
+  const double seconds_elapsed = duration<double>( steady_clock::now() - start_time ).count();
+
+  cout << statistics.frame_count() / seconds_elapsed << " frames per second\n";
+  cout << statistics.summary_line() << "\n";
+
+  const vector<uint8_t> output = display.read_rgba();
+  const bool correct
+    = pixel_is( output, width, width / 4, height / 2, 255 ) and pixel_is( output, width, 3 * width / 4, height / 2, 0 );
+
+  cout << "Output " << ( correct ? "matches" : "DOES NOT MATCH" ) << " the expected image\n";
+
+  /* and round trip through the asynchronous capture path */
+  display.start_capture( CaptureFormat::YCbCr420 );
+  for ( unsigned int i = 0; i < 4; i++ ) {
+    display.draw( split_texture );
+  }
+  display.capture()->flush();
+
+  bool round_trip_correct = display.capture()->queued() == 4;
+  while ( const auto frame = display.capture()->pop() ) {
+    const ConstPlaneView Y = frame->ycbcr->Y.view();
+    round_trip_correct = round_trip_correct and abs( Y.at( width / 4, height / 2 ) - 235 ) <= 2
+                         and abs( Y.at( 3 * width / 4, height / 2 ) - 16 ) <= 2;
+  }
+  display.stop_capture();
+
+  cout << "Captured Y'CbCr " << ( round_trip_correct ? "matches" : "DOES NOT MATCH" ) << " the source\n";
+
+  /* NV12: the same split, with the right half red (BT.709, limited range), so swapped or
+     misaligned chroma pairs would show */
+  RasterNV12 split_nv12 { width, height };
+  for ( unsigned int y = 0; y < height; y++ ) {
+    for ( unsigned int x = 0; x < width; x++ ) {
+      split_nv12.Y.at( x, y ) = ( x < width / 2 ) ? 235 : 63;
+    }
+  }
+  for ( unsigned int y = 0; y < height / 2; y++ ) {
+    for ( unsigned int x = width / 4; x < width / 2; x++ ) {
+      split_nv12.CbCr.at( 2 * x, y ) = 102;
+      split_nv12.CbCr.at( 2 * x + 1, y ) = 240;
+    }
+  }
+  TextureNV12 nv12_texture { split_nv12 };
+  display.draw( nv12_texture );
+
+  const vector<uint8_t> nv12_output = display.read_rgba();
+  const bool nv12_correct = pixel_is( nv12_output, width, width / 4, height / 2, 255 )
+                            and pixel_is( nv12_output, width, 3 * width / 4, height / 2, { 255, 0, 0 } );
+
+  cout << "NV12 output " << ( nv12_correct ? "matches" : "DOES NOT MATCH" ) << " the expected image\n";
+
+  if ( not correct or not round_trip_correct or not nv12_correct ) {
+    throw runtime_error( "YCbCr shader produced unexpected output" );
+  }
+
+  /* damage on an odd-sized canvas must reach its last column and row, in the raster and in
+     the texture (the bottom-right tile is redrawn after the first full upload) */
+  constexpr unsigned int odd_width = 101, odd_height = 75;
+  Cairo odd_canvas { odd_width, odd_height, 16 };
+  cairo_set_source_rgba( odd_canvas, 0.2, 0.4, 0.6, 1 );
+  odd_canvas.paint();
+  CanvasUploader odd_uploader { odd_canvas };
+
+  cairo_rectangle( odd_canvas, 90, 60, 20, 20 );
+  cairo_set_source_rgba( odd_canvas, 1, 0, 0, 1 );
+  odd_canvas.fill();
+
+  bool odd_edges_damaged = false;
+  for ( const auto& r : odd_canvas.damage().rectangles() ) {
+    odd_edges_damaged = odd_edges_damaged or ( r.x + r.width == odd_width and r.y + r.height == odd_height );
+  }
+  odd_uploader.update( odd_canvas );
+
+  Raster420 odd_reference { odd_width, odd_height };
+  bgra_to_ycbcr420( odd_canvas.pixels(), odd_canvas.stride(), odd_reference );
+
+  vector<uint8_t> odd_uploaded_luma( odd_width * odd_height );
+  odd_uploader.texture().Y.bind( GL_TEXTURE0 );
+  glPixelStorei( GL_PACK_ALIGNMENT, 1 );
+  glGetTexImage( GL_TEXTURE_RECTANGLE, 0, GL_RED, GL_UNSIGNED_BYTE, odd_uploaded_luma.data() );
+
+  const ConstPlaneView odd_converted_luma = odd_uploader.raster().Y.view();
+  bool odd_correct = odd_edges_damaged;
+  for ( unsigned int y = 0; y < odd_height; y++ ) {
+    for ( unsigned int x = 0; x < odd_width; x++ ) {
+      odd_correct = odd_correct and odd_converted_luma.at( x, y ) == odd_reference.Y.at( x, y )
+                    and odd_uploaded_luma.at( y * odd_width + x ) == odd_reference.Y.at( x, y );
+    }
+  }
+
+  cout << "Odd-sized canvas " << ( odd_correct ? "matches" : "DOES NOT MATCH" ) << " after a partial update\n";
+
+  if ( not odd_correct ) {
+    throw runtime_error( "CanvasUploader missed the edge of an odd-sized canvas" );
+  }
+
+  /* a multiviewer: a grid of layers, each showing the middle half of the picture */
+  constexpr unsigned int columns = 6, rows = 6;
+  vector<Compositor::Layer> grid;
+  for ( unsigned int row = 0; row < rows; row++ ) {
+    for ( unsigned int column = 0; column < columns; column++ ) {
+      Compositor::Layer layer;
+      layer.picture = &split_texture;
+      layer.destination = { float( column * width ) / columns,
+                            float( row * height ) / rows,
+                            float( width ) / columns,
+                            float( height ) / rows };
+      layer.crop = { width / 4 & ~1u, height / 4 & ~1u, width / 2 & ~1u, height / 2 & ~1u };
+      grid.push_back( layer );
+    }
+  }
+
+  cout << "Compositing " << grid.size() << " layers for " << seconds_to_run << " s\n";
+
+  const uint64_t frames_before = statistics.frame_count();
+  const auto grid_start_time = steady_clock::now();
+  while ( steady_clock::now() - grid_start_time < seconds( seconds_to_run ) ) {
+    for ( unsigned int i = 0; i < 16; i++ ) {
+      display.draw( grid );
+    }
+  }
+  const double grid_seconds = duration<double>( steady_clock::now() - grid_start_time ).count();
+
+  cout << ( statistics.frame_count() - frames_before ) / grid_seconds << " frames per second\n";
+
+  /* in the top-left cell, a quarter of the way across is white and three quarters is black */
+  const vector<uint8_t> grid_output = display.read_rgba();
+  const unsigned int cell_row = height - 1 - height / rows / 2;
+  const bool grid_correct = pixel_is( grid_output, width, width / columns / 4, cell_row, 255 )
+                            and pixel_is( grid_output, width, 3 * width / columns / 4, cell_row, 0 );
+
+  cout << "Layered output " << ( grid_correct ? "matches" : "DOES NOT MATCH" ) << " the expected image\n";
+
+  if ( not grid_correct ) {
+    throw runtime_error( "Compositor produced unexpected output" );
+  }
+}
+
+int main( int argc, char* argv[] )
+{
+  if ( argc != 1 and argc != 3 and argc != 4 ) {
+    cerr << "Usage: " << argv[0] << " [width height [seconds]]\n";
+    return EXIT_FAILURE;
+  }
+
+  try {
+    if ( argc >= 3 ) {
+      program_body( stoul( argv[1] ), stoul( argv[2] ), argc == 4 ? stoul( argv[3] ) : 2 );
+    } else {
+      program_body( 1920, 1080, 2 );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
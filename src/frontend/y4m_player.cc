@@ -0,0 +1,243 @@
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <thread>
+
+#include "display.hh"
+#include "frame_recorder.hh"
+#include "presentation_scheduler.hh"
+#include "spsc_queue.hh"
+#include "texture_uploader.hh"
+#include "y4m.hh"
+
+using namespace std;
+using namespace std::chrono;
+
+void program_body( const string& filename,
+                   const bool loop,
+                   const string& record_filename,
+                   const bool upload_thread )
+{
+  Y4MReader video { filename };
+  if ( video.frame_count() == 0 ) {
+    throw runtime_error( filename + ": no frames" );
+  }
+
+  cout << filename << ": " << video.width() << "x" << video.height() << ", " << video.bit_depth() << "-bit, "
+       << video.frame_count() << " frames at " << video.frame_rate() << " fps\n";
+
+  VideoDisplay display { video.width(), video.height() };
+  display.window().set_swap_interval( 1 );
+  display.print_statistics_every( 240 );
+
+  /* deeper video goes to 16-bit textures, with the shader normalizing for the bit depth */
+  optional<Texture420> texture;
+  optional<Texture420_16> deep_texture;
+  if ( video.bit_depth() > 8 ) {
+    deep_texture.emplace( video.width(), video.height() );
+    deep_texture->bit_depth = video.bit_depth();
+  } else {
+    texture.emplace( video.width(), video.height() );
+  }
+
+  /* optionally, upload on a thread of its own; the loop below then only binds and draws */
+  optional<TextureUploader> uploader;
+  if ( upload_thread ) {
+    if ( deep_texture ) {
+      throw runtime_error( "--upload-thread supports 8-bit video only" );
+    }
+    uploader.emplace( display.window(), video.width(), video.height() );
+  }
+  deque<TextureUploader::Frame> scheduled_uploads; /* in step with the scheduler's queue */
+  optional<TextureUploader::Frame> showing;
+
+  /* optionally, record what is actually displayed */
+  unique_ptr<FrameRecorder> recorder;
+  if ( not record_filename.empty() ) {
+    FrameRecorder::Options options;
+    options.frame_rate_numerator = lround( video.frame_rate() > 0 ? video.frame_rate() * 1000 : 60000 );
+    options.frame_rate_denominator = 1000;
+    recorder = make_unique<FrameRecorder>( record_filename, video.width(), video.height(), options );
+
+    display.start_capture( CaptureFormat::YCbCr420,
+                           [&]( CapturedFrame&& frame ) { recorder->record( *frame.ycbcr ); } );
+  }
+
+  /* The reader thread faults frames into memory ahead of time and passes their indices over;
+     the frame itself goes straight from the mapping into the texture, so the only copy is
+     the one the driver makes. */
+  SPSCQueue<size_t> ready_frames { 8 };
+  atomic<bool> stop { false }, reader_finished { false };
+  exception_ptr reader_error {};
+
+  thread reader { [&] {
+    try {
+      for ( size_t index = 0; not stop; index++ ) {
+        if ( index == video.frame_count() ) {
+          if ( not loop ) {
+            break;
+          }
+          index = 0;
+        }
+
+        video.prefetch( index, 1 );
+
+        while ( not ready_frames.try_push( size_t { index } ) ) {
+          if ( stop ) {
+            return;
+          }
+          this_thread::sleep_for( milliseconds( 1 ) );
+        }
+      }
+    } catch ( ... ) {
+      reader_error = current_exception();
+    }
+    reader_finished = true;
+  } };
+
+  /* Each frame is due one frame interval after the last (looping or not), counted from
+     when playback starts; the scheduler shows it on the nearest vblank, drops it if the
+     player has fallen behind, and sleeps in between. Without a frame rate, show one frame
+     per refresh. */
+  PresentationScheduler scheduler { display, [&]( const PresentationScheduler::Frame& frame ) {
+                                     if ( uploader ) {
+                                       uploader->release( scheduled_uploads.front() );
+                                       scheduled_uploads.pop_front();
+                                     } else {
+                                       video.release( frame.id );
+                                     }
+                                   } };
+  const duration<double> frame_interval { video.frame_rate() > 0 ? 1.0 / video.frame_rate()
+                                                                 : scheduler.refresh_period().count() };
+  const auto start = steady_clock::now();
+  const auto due = [&]( const uint64_t sequence ) {
+    return start + duration_cast<steady_clock::duration>( frame_interval * sequence );
+  };
+  uint64_t frames_queued = 0, frames_shown = 0, underruns = 0, uploads_in_flight = 0;
+
+  while ( not display.window().should_close() ) {
+    if ( uploader ) {
+      while ( uploader->accepting() ) {
+        const auto index = ready_frames.try_pop();
+        if ( not index ) {
+          break;
+        }
+        uploader->submit( *index, video.frame( *index ) );
+        uploads_in_flight++;
+      }
+
+      while ( not scheduler.full() ) {
+        const auto uploaded = uploader->acquire();
+        if ( not uploaded ) {
+          break;
+        }
+        uploads_in_flight--;
+        video.release( uploaded->id );
+        scheduled_uploads.push_back( *uploaded );
+        scheduler.push( { due( frames_queued++ ), uploaded->id } );
+      }
+    } else {
+      while ( not scheduler.full() ) {
+        const auto index = ready_frames.try_pop();
+        if ( not index ) {
+          break;
+        }
+        scheduler.push( { due( frames_queued++ ), uint64_t { *index } } );
+      }
+    }
+
+    if ( scheduler.queued() == 0 and frames_queued > 0 ) {
+      if ( reader_finished and ready_frames.size() == 0 and uploads_in_flight == 0 ) {
+        break;
+      }
+      underruns++;
+    }
+
+    const auto frame = scheduler.next();
+    if ( frame ) {
+      if ( uploader ) {
+        /* everything drawn from the previous frame has been issued, so it can go back */
+        if ( showing ) {
+          uploader->release( *showing );
+        }
+        showing = scheduled_uploads.front();
+        scheduled_uploads.pop_front();
+      } else {
+        if ( deep_texture ) {
+          deep_texture->load( video.frame16( frame->id ) );
+        } else {
+          texture->load( video.frame( frame->id ) );
+        }
+        video.release( frame->id );
+      }
+      frames_shown++;
+    }
+
+    if ( showing ) {
+      display.draw( *showing->texture );
+    } else if ( deep_texture ) {
+      display.draw( *deep_texture );
+    } else {
+      display.draw( *texture );
+    }
+    glfwPollEvents();
+  }
+
+  stop = true;
+  reader.join();
+
+  if ( recorder ) {
+    display.stop_capture();
+    recorder->finish();
+
+    const auto recording = recorder->statistics();
+    cout << "Recorded " << recording.frames_recorded << " frames to " << record_filename << " ("
+         << recording.frames_dropped << " dropped, ring peaked at " << 100 * recording.peak_fill
+         << "% full, slowest write " << recording.slowest_write_ms << " ms)\n";
+  }
+
+  if ( reader_error ) {
+    rethrow_exception( reader_error );
+  }
+
+  cout << "Showed " << frames_shown << " frames (" << underruns << " underruns)\n";
+  cout << scheduler.summary_line() << "\n";
+  cout << display.statistics().summary_line() << "\n";
+}
+
+int main( int argc, char* argv[] )
+{
+  if ( argc < 2 ) {
+    cerr << "Usage: " << argv[0] << " FILE.y4m [--loop] [--upload-thread] [--record OUTPUT.y4m]\n";
+    return EXIT_FAILURE;
+  }
+
+  try {
+    bool loop = false, upload_thread = false;
+    string record_filename;
+
+    for ( int i = 2; i < argc; i++ ) {
+      if ( strcmp( argv[i], "--loop" ) == 0 ) {
+        loop = true;
+      } else if ( strcmp( argv[i], "--upload-thread" ) == 0 ) {
+        upload_thread = true;
+      } else if ( strcmp( argv[i], "--record" ) == 0 and i + 1 < argc ) {
+        record_filename = argv[++i];
+      } else {
+        throw runtime_error( string( "unexpected argument " ) + argv[i] );
+      }
+    }
+
+    program_body( argv[1], loop, record_filename, upload_thread );
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,115 @@
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "ycbcr.hh"
+
+using namespace std;
+using namespace std::chrono;
+
+bool same_plane( const Plane& a, const Plane& b )
+{
+  for ( unsigned int y = 0; y < a.height(); y++ ) {
+    if ( not equal( a.row( y ), a.row( y ) + a.width(), b.row( y ) ) ) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool same_raster( const Raster420& a, const Raster420& b )
+{
+  return same_plane( a.Y, b.Y ) and same_plane( a.Cb, b.Cb ) and same_plane( a.Cr, b.Cr );
+}
+
+void program_body( const unsigned int width, const unsigned int height )
+{
+  const unsigned int stride = 4 * width;
+
+  /* random pixels, so no kernel gets lucky with constant input */
+  vector<uint8_t> bgra( stride * height );
+  minstd_rand prng;
+  for ( auto& byte : bgra ) {
+    byte = prng();
+  }
+
+  ThreadPool single_thread { 1 };
+
+  /* every colorimetry's instance of each kernel is checked, but only the default is timed */
+  vector<Raster420> references;
+  for ( unsigned int i = 0; i < COLORIMETRY_VARIANTS; i++ ) {
+    references.emplace_back( width, height );
+    bgra_to_ycbcr420(
+      bgra.data(), stride, references.back(), colorimetry_variant( i ), YCbCrKernel::Scalar, single_thread );
+  }
+
+  cout << "Converting " << width << "x" << height << " BGRA to 4:2:0 Y'CbCr (best kernel: "
+       << ycbcr_kernel_name( ycbcr_best_kernel() ) << ")\n";
+
+  for ( const auto kernel : { YCbCrKernel::Scalar, YCbCrKernel::SSE41, YCbCrKernel::AVX2, YCbCrKernel::AVX512 } ) {
+    if ( not ycbcr_kernel_supported( kernel ) ) {
+      cout << setw( 10 ) << ycbcr_kernel_name( kernel ) << ": not supported on this CPU\n";
+      continue;
+    }
+
+    Raster420 output { width, height, false };
+    bool matches = true;
+    for ( unsigned int i = 0; i < COLORIMETRY_VARIANTS; i++ ) {
+      bgra_to_ycbcr420( bgra.data(), stride, output, colorimetry_variant( i ), kernel );
+      matches = matches and same_raster( output, references.at( i ) );
+    }
+
+    cout << setw( 10 ) << ycbcr_kernel_name( kernel ) << ":";
+    for ( ThreadPool* pool : { &single_thread, &ThreadPool::shared() } ) {
+      /* run for at least a second */
+      unsigned int frame_count = 0;
+      const auto start_time = steady_clock::now();
+      auto now = start_time;
+      while ( now - start_time < seconds( 1 ) ) {
+        for ( unsigned int i = 0; i < 8; i++ ) {
+          bgra_to_ycbcr420( bgra.data(), stride, output, {}, kernel, *pool );
+        }
+        frame_count += 8;
+        now = steady_clock::now();
+      }
+
+      const double seconds_elapsed = duration<double>( now - start_time ).count();
+      const double bytes = double( frame_count ) * stride * height;
+
+      cout << "  " << setw( 2 ) << pool->thread_count() << " thread(s): " << fixed << setprecision( 2 ) << setw( 6 )
+           << bytes / seconds_elapsed / 1e9 << " GB/s, " << setprecision( 3 ) << 1000.0 * seconds_elapsed / frame_count
+           << " ms/frame";
+    }
+
+    cout << ( matches ? "" : " [MISMATCH with scalar output]" ) << "\n";
+  }
+}
+
+int main( int argc, char* argv[] )
+{
+  if ( argc != 1 and argc != 3 and argc != 4 ) {
+    cerr << "Usage: " << argv[0] << " [width height [threads]]\n";
+    return EXIT_FAILURE;
+  }
+
+  try {
+    if ( argc == 4 ) {
+      ThreadPool::set_shared_thread_count( stoul( argv[3] ) );
+    }
+
+    if ( argc >= 3 ) {
+      program_body( stoul( argv[1] ), stoul( argv[2] ) );
+    } else {
+      program_body( 1920, 1080 );
+    }
+  } catch ( const exception& e ) {
+    cerr << "Exception: " << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
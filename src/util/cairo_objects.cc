@@ -1,5 +1,6 @@
 #include "cairo_objects.hh"
 
+#include <algorithm>
 #include <mutex>
 #include <stdexcept>
 
@@ -40,13 +41,83 @@ void Pango::Text::Deleter::operator()( cairo_path_t* x ) const
   cairo_path_destroy( x );
 }
 
-Cairo::Cairo( const unsigned int width, const unsigned int height )
-  : surface_( width, height )
+Cairo::Cairo( const unsigned int width, const unsigned int height, const unsigned int damage_tile_size )
+  : Cairo( width, height, CAIRO_FORMAT_RGB24, damage_tile_size )
+{}
+
+Cairo::Cairo( const unsigned int width,
+              const unsigned int height,
+              const cairo_format_t format,
+              const unsigned int damage_tile_size )
+  : surface_( width, height, format )
   , context_( surface_ )
+  , damage_( width, height, damage_tile_size )
 {
   check_error();
 }
 
+/* (x1, y1)-(x2, y2) is in user space; its device-space bounding box may be larger if rotated */
+void Cairo::add_damage( const double x1, const double y1, const double x2, const double y2 )
+{
+  double xs[4] = { x1, x2, x1, x2 }, ys[4] = { y1, y1, y2, y2 };
+  for ( unsigned int i = 0; i < 4; i++ ) {
+    cairo_user_to_device( *this, &xs[i], &ys[i] );
+  }
+
+  damage_.add(
+    *min_element( xs, xs + 4 ), *min_element( ys, ys + 4 ), *max_element( xs, xs + 4 ), *max_element( ys, ys + 4 ) );
+}
+
+namespace {
+
+/* these operators change the destination even where the source is transparent */
+bool unbounded( cairo_t* cairo )
+{
+  switch ( cairo_get_operator( cairo ) ) {
+    case CAIRO_OPERATOR_IN:
+    case CAIRO_OPERATOR_OUT:
+    case CAIRO_OPERATOR_DEST_IN:
+    case CAIRO_OPERATOR_DEST_ATOP:
+      return true;
+    default:
+      return false;
+  }
+}
+
+}
+
+void Cairo::fill()
+{
+  double x1, y1, x2, y2;
+  if ( unbounded( *this ) ) {
+    cairo_clip_extents( *this, &x1, &y1, &x2, &y2 );
+  } else {
+    cairo_fill_extents( *this, &x1, &y1, &x2, &y2 );
+  }
+  add_damage( x1, y1, x2, y2 );
+  cairo_fill( *this );
+}
+
+void Cairo::stroke()
+{
+  double x1, y1, x2, y2;
+  if ( unbounded( *this ) ) {
+    cairo_clip_extents( *this, &x1, &y1, &x2, &y2 );
+  } else {
+    cairo_stroke_extents( *this, &x1, &y1, &x2, &y2 );
+  }
+  add_damage( x1, y1, x2, y2 );
+  cairo_stroke( *this );
+}
+
+void Cairo::paint()
+{
+  double x1, y1, x2, y2;
+  cairo_clip_extents( *this, &x1, &y1, &x2, &y2 );
+  add_damage( x1, y1, x2, y2 );
+  cairo_paint( *this );
+}
+
 ImageSurface::ImageSurface( cairo_surface_t* surface_ptr )
   : Surface( surface_ptr )
   , width_( cairo_image_surface_get_width( *this ) )
@@ -93,6 +164,18 @@ Pango::Font::Font( const string& description )
   : font( pango_font_description_from_string( description.c_str() ) )
 {}
 
+Pango::Font::Font( PangoFontDescription* description )
+  : font( description )
+{}
+
+string Pango::Font::description() const
+{
+  char* description = pango_font_description_to_string( font.get() );
+  const string result { description };
+  g_free( description );
+  return result;
+}
+
 void Pango::set_font( const Pango::Font& font )
 {
   pango_layout_set_font_description( *this, font );
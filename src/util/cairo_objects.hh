@@ -4,8 +4,10 @@
 #include <cairo.h>
 #include <limits>
 #include <memory>
+#include <mutex>
 #include <pango/pangocairo.h>
 
+#include "damage.hh"
 #include "gl_objects.hh"
 
 class Surface
@@ -45,8 +47,10 @@ public:
 class FreshImageSurface : public ImageSurface
 {
 public:
-  FreshImageSurface( const unsigned int width, const unsigned int height )
-    : ImageSurface( cairo_image_surface_create( CAIRO_FORMAT_RGB24, width, height ) )
+  FreshImageSurface( const unsigned int width,
+                     const unsigned int height,
+                     const cairo_format_t format = CAIRO_FORMAT_RGB24 )
+    : ImageSurface( cairo_image_surface_create( format, width, height ) )
   {}
 };
 
@@ -76,10 +80,19 @@ class Cairo
     void check_error();
   } context_;
 
+  TileDamage damage_;
+
   void check_error();
+  void add_damage( const double x1, const double y1, const double x2, const double y2 );
 
 public:
-  Cairo( const unsigned int width, const unsigned int height );
+  Cairo( const unsigned int width, const unsigned int height, const unsigned int damage_tile_size = 64 );
+
+  /* CAIRO_FORMAT_ARGB32 gives a canvas with (premultiplied) alpha, for overlays; it starts transparent */
+  Cairo( const unsigned int width,
+         const unsigned int height,
+         const cairo_format_t format,
+         const unsigned int damage_tile_size = 64 );
 
   unsigned int width() { return surface_.width(); }
   unsigned int height() { return surface_.height(); }
@@ -90,6 +103,17 @@ public:
   uint8_t* pixels() { return surface_.pixels(); }
   void flush() { cairo_surface_flush( surface_ ); }
 
+  /* cairo_fill(), cairo_stroke() and cairo_paint(), recording the area they may change.
+     Drawing through the context directly doesn't; call mark_damaged() after it. */
+  void fill();
+  void stroke();
+  void paint();
+  void mark_damaged() { damage_.add_all(); }
+
+  /* what has been drawn since the damage was last cleared */
+  TileDamage& damage() { return damage_; }
+  const TileDamage& damage() const { return damage_; }
+
   template<bool device_coordinates>
   struct Extent
   {
@@ -143,6 +167,9 @@ struct PangoDelete
   void operator()( T* x ) const { g_object_unref( x ); }
 };
 
+/* Pango is not thread-safe; hold this while using it */
+std::mutex& global_pango_mutex();
+
 class Pango
 {
   std::unique_ptr<PangoContext, PangoDelete<PangoContext>> context_;
@@ -165,6 +192,12 @@ public:
 
     Font( const std::string& description );
 
+    /* takes ownership */
+    explicit Font( PangoFontDescription* description );
+
+    /* normalized, so equivalent fonts have equal descriptions */
+    std::string description() const;
+
     operator const PangoFontDescription*() const { return font.get(); }
   };
 
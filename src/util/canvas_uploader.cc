@@ -0,0 +1,113 @@
+#include <stdexcept>
+
+#include "canvas_uploader.hh"
+
+using namespace std;
+
+namespace {
+
+/* below this, handing the rectangles out to the pool costs more than converting them */
+constexpr uint64_t PARALLEL_THRESHOLD_PIXELS = 256 * 1024;
+
+/* whole 4:2:0 samples for the even part; an odd last column or row (at the image's edge)
+   has no chroma of its own, so it goes up as luma alone */
+void load_rectangle( Texture420& texture, const ConstRaster420View& whole, const PixelRect& r )
+{
+  const unsigned int even_width = r.width & ~1u, even_height = r.height & ~1u;
+
+  texture.load( whole.crop( r.x, r.y, even_width, even_height ) );
+
+  if ( r.width % 2 ) {
+    texture.Y.load( whole.Y.crop( r.x + even_width, r.y, 1, r.height ), GL_TEXTURE0 );
+  }
+  if ( r.height % 2 ) {
+    texture.Y.load( whole.Y.crop( r.x, r.y + even_height, even_width, 1 ), GL_TEXTURE0 );
+  }
+}
+
+}
+
+CanvasUploader::CanvasUploader( Cairo& cairo, const Colorimetry colorimetry, const YCbCrKernel kernel )
+  : raster_( cairo.width(), cairo.height(), false )
+  , texture_( cairo.width(), cairo.height() )
+  , colorimetry_( colorimetry )
+  , kernel_( kernel )
+{
+  texture_.colorimetry = colorimetry_;
+
+  cairo.flush();
+  bgra_to_ycbcr420( cairo.pixels(), cairo.stride(), raster_, colorimetry_, kernel_ );
+  texture_.load( raster_ );
+  cairo.damage().clear();
+
+  pixels_converted_ = uint64_t( cairo.width() ) * cairo.height();
+}
+
+uint64_t CanvasUploader::update( Cairo& cairo )
+{
+  if ( cairo.width() != raster_.Y.width() or cairo.height() != raster_.Y.height() ) {
+    throw runtime_error( "CanvasUploader: canvas dimensions have changed" );
+  }
+
+  TileDamage& damage = cairo.damage();
+  if ( damage.empty() ) {
+    return 0;
+  }
+
+  cairo.flush();
+
+  const vector<PixelRect> rectangles = damage.rectangles();
+  uint64_t pixels = 0;
+  for ( const auto& r : rectangles ) {
+    pixels += uint64_t( r.width ) * r.height;
+  }
+
+  const uint8_t* bgra = cairo.pixels();
+  const unsigned int stride = cairo.stride();
+  const auto convert = [&]( const unsigned int begin, const unsigned int end ) {
+    for ( unsigned int i = begin; i < end; i++ ) {
+      const PixelRect& r = rectangles[i];
+      bgra_to_ycbcr420_rect( bgra, stride, raster_, r.x, r.y, r.width, r.height, colorimetry_, kernel_ );
+    }
+  };
+
+  if ( pixels >= PARALLEL_THRESHOLD_PIXELS and rectangles.size() > 1 ) {
+    ThreadPool::shared().parallel_for( 0, rectangles.size(), convert );
+  } else {
+    convert( 0, rectangles.size() );
+  }
+
+  const ConstRaster420View whole = raster_.view();
+  for ( const auto& r : rectangles ) {
+    load_rectangle( texture_, whole, r );
+  }
+
+  damage.clear();
+  pixels_converted_ += pixels;
+
+  return pixels;
+}
+
+uint64_t upload_damage( Cairo& cairo, TextureBGRA& texture, const GLenum texture_unit )
+{
+  if ( cairo.width() != texture.width() or cairo.height() != texture.height() ) {
+    throw runtime_error( "upload_damage: canvas and texture dimensions differ" );
+  }
+
+  TileDamage& damage = cairo.damage();
+  if ( damage.empty() ) {
+    return 0;
+  }
+
+  cairo.flush();
+
+  uint64_t pixels = 0;
+  for ( const auto& r : damage.rectangles() ) {
+    texture.load( cairo.pixels(), cairo.stride(), r.x, r.y, r.width, r.height, texture_unit );
+    pixels += uint64_t( r.width ) * r.height;
+  }
+
+  damage.clear();
+
+  return pixels;
+}
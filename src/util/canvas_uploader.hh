@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+
+#include "cairo_objects.hh"
+#include "gl_objects.hh"
+#include "raster.hh"
+#include "ycbcr.hh"
+
+/* Keeps a Texture420 in step with a Cairo canvas, converting and uploading only what changed.
+
+   The canvas records which tiles its drawing operations touched (see TileDamage); each
+   update() converts just those rectangles to Y'CbCr, in place in a raster that mirrors
+   the texture, uploads each rectangle as a sub-image, and clears the damage. A canvas
+   whose clock or counter changes once a second costs a few tiles per update, not a frame. */
+class CanvasUploader
+{
+  Raster420 raster_;
+  Texture420 texture_;
+  Colorimetry colorimetry_;
+  YCbCrKernel kernel_;
+
+  uint64_t pixels_converted_ = 0;
+
+public:
+  /* converts and uploads the whole canvas, and labels the texture with `colorimetry`;
+     must be called with the GL context current */
+  explicit CanvasUploader( Cairo& cairo,
+                           const Colorimetry colorimetry = {},
+                           const YCbCrKernel kernel = ycbcr_best_kernel() );
+
+  /* bring the texture up to date with the canvas; returns the number of pixels converted */
+  uint64_t update( Cairo& cairo );
+
+  Texture420& texture() { return texture_; }
+  const Raster420& raster() const { return raster_; }
+
+  /* since construction, including the first full conversion */
+  uint64_t pixels_converted() const { return pixels_converted_; }
+};
+
+/* For a canvas drawn as an overlay (CAIRO_FORMAT_ARGB32): upload just its damaged rectangles
+   into `texture`, which is the same size, and clear the damage. Returns the pixels uploaded. */
+uint64_t upload_damage( Cairo& cairo, TextureBGRA& texture, const GLenum texture_unit );
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <cstdint>
+
+/* Y'CbCr colorimetry: which RGB <-> Y'CbCr matrix, and whether the samples use the
+   limited ("studio", 16-235/240) or full (0-255) range.
+
+   The matrices are derived here, once, at compile time, from each standard's luma
+   weights; the CPU conversion kernels and the GLSL shaders are both generated from
+   these tables. Everything is constexpr, so the kernels (which must not pull in inline
+   functions; see ycbcr_kernels.hh) use it only in constant expressions. */
+
+enum class ColorMatrix : uint8_t
+{
+  BT601, /* SMPTE 170M / BT.601 */
+  BT709,
+  BT2020 /* non-constant luminance */
+};
+
+enum class ColorRange : uint8_t
+{
+  Limited,
+  Full
+};
+
+constexpr unsigned int COLORIMETRY_VARIANTS = 6;
+
+/* a dense index, matrix-major, for tables of variants */
+constexpr unsigned int colorimetry_index( const ColorMatrix matrix, const ColorRange range )
+{
+  return 2 * static_cast<unsigned int>( matrix ) + static_cast<unsigned int>( range );
+}
+
+struct Colorimetry
+{
+  ColorMatrix matrix = ColorMatrix::BT709;
+  ColorRange range = ColorRange::Limited;
+
+  constexpr unsigned int index() const { return colorimetry_index( matrix, range ); }
+  constexpr bool operator==( const Colorimetry& other ) const { return index() == other.index(); }
+  constexpr bool operator!=( const Colorimetry& other ) const { return index() != other.index(); }
+};
+
+/* the inverse of Colorimetry::index() */
+constexpr Colorimetry colorimetry_variant( const unsigned int index )
+{
+  return { ColorMatrix( index / 2 ), ColorRange( index % 2 ) };
+}
+
+namespace colorimetry {
+
+struct LumaWeights
+{
+  double red, blue; /* green is the rest */
+};
+
+constexpr LumaWeights luma_weights( const ColorMatrix matrix )
+{
+  switch ( matrix ) {
+    case ColorMatrix::BT601:
+      return { 0.299, 0.114 };
+    case ColorMatrix::BT709:
+      return { 0.2126, 0.0722 };
+    case ColorMatrix::BT2020:
+      return { 0.2627, 0.0593 };
+  }
+  return { 0, 0 };
+}
+
+/* the span of each component in 8-bit code values, and the code value of black / zero chroma */
+constexpr double luma_span( const ColorRange range ) { return range == ColorRange::Limited ? 219 : 255; }
+constexpr double chroma_span( const ColorRange range ) { return range == ColorRange::Limited ? 224 : 255; }
+constexpr double luma_offset( const ColorRange range ) { return range == ColorRange::Limited ? 16 : 0; }
+constexpr double CHROMA_OFFSET = 128;
+
+constexpr int32_t round_to_int( const double x )
+{
+  return x < 0 ? -int32_t( -x + 0.5 ) : int32_t( x + 0.5 );
+}
+
+/* RGB -> Y'CbCr in 2.14 fixed point, for 8-bit samples:
+
+   Y' = luma_offset + luma_span/255 * ( kr R + kg G + kb B )
+   Cb = 128 + chroma_span/255 * ( B - Y ) / ( 2 (1 - kb) )
+   Cr = 128 + chroma_span/255 * ( R - Y ) / ( 2 (1 - kr) )
+
+   Green absorbs the rounding of each row, so that gray maps exactly to zero chroma and
+   white to the top of the luma span. Chroma is computed from the sum of each 2x2 block,
+   so its bias carries two extra bits. */
+
+constexpr int SHIFT = 14;
+
+struct ForwardCoefficients
+{
+  int16_t y_r, y_g, y_b;
+  int16_t cb_r, cb_g, cb_b;
+  int16_t cr_r, cr_g, cr_b;
+  int32_t y_bias, c_bias;
+};
+
+constexpr ForwardCoefficients forward_coefficients( const ColorMatrix matrix, const ColorRange range )
+{
+  const double kr = luma_weights( matrix ).red, kb = luma_weights( matrix ).blue;
+  const double unit = 1 << SHIFT;
+  const double y_scale = unit * luma_span( range ) / 255, c_scale = unit * chroma_span( range ) / 255;
+
+  const int32_t y_r = round_to_int( y_scale * kr ), y_b = round_to_int( y_scale * kb );
+  const int32_t y_g = round_to_int( y_scale ) - y_r - y_b;
+
+  const int32_t cb_r = round_to_int( -c_scale * kr / ( 2 * ( 1 - kb ) ) ), cb_b = round_to_int( c_scale / 2 );
+  const int32_t cr_r = round_to_int( c_scale / 2 ), cr_b = round_to_int( -c_scale * kb / ( 2 * ( 1 - kr ) ) );
+
+  return { int16_t( y_r ),
+           int16_t( y_g ),
+           int16_t( y_b ),
+           int16_t( cb_r ),
+           int16_t( -cb_r - cb_b ),
+           int16_t( cb_b ),
+           int16_t( cr_r ),
+           int16_t( -cr_r - cr_b ),
+           int16_t( cr_b ),
+           round_to_int( luma_offset( range ) ) * ( 1 << SHIFT ) + ( 1 << ( SHIFT - 1 ) ),
+           round_to_int( CHROMA_OFFSET ) * ( 1 << ( SHIFT + 2 ) ) + ( 1 << ( SHIFT + 1 ) ) };
+}
+
+/* Y'CbCr -> RGB, for samples normalized to 0..1 as a shader sees them: rgb = matrix * ycbcr + offset */
+struct InverseCoefficients
+{
+  double matrix[3][3]; /* rows R, G, B; columns Y', Cb, Cr */
+  double offset[3];
+};
+
+constexpr InverseCoefficients inverse_coefficients( const ColorMatrix matrix, const ColorRange range )
+{
+  const double kr = luma_weights( matrix ).red, kb = luma_weights( matrix ).blue, kg = 1 - kr - kb;
+  const double y_scale = 255 / luma_span( range ), c_scale = 255 / chroma_span( range );
+
+  InverseCoefficients result {
+    { { y_scale, 0, c_scale * 2 * ( 1 - kr ) },
+      { y_scale, -c_scale * 2 * kb * ( 1 - kb ) / kg, -c_scale * 2 * kr * ( 1 - kr ) / kg },
+      { y_scale, c_scale * 2 * ( 1 - kb ), 0 } },
+    { 0, 0, 0 } };
+
+  const double black[3] = { luma_offset( range ) / 255, CHROMA_OFFSET / 255, CHROMA_OFFSET / 255 };
+  for ( unsigned int row = 0; row < 3; row++ ) {
+    for ( unsigned int column = 0; column < 3; column++ ) {
+      result.offset[row] -= result.matrix[row][column] * black[column];
+    }
+  }
+
+  return result;
+}
+
+}
@@ -0,0 +1,99 @@
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+#include "colorimetry_glsl.hh"
+
+using namespace std;
+using namespace colorimetry;
+
+namespace {
+
+/* mat3() takes columns, so the matrix goes in transposed */
+string glsl_matrix( const InverseCoefficients& inverse )
+{
+  ostringstream out;
+  out << setprecision( 9 ) << "mat3( ";
+  for ( unsigned int column = 0; column < 3; column++ ) {
+    for ( unsigned int row = 0; row < 3; row++ ) {
+      out << fixed << inverse.matrix[row][column] << ( column == 2 and row == 2 ? " )" : ", " );
+    }
+  }
+  return out.str();
+}
+
+string glsl_offset( const InverseCoefficients& inverse )
+{
+  ostringstream out;
+  out << setprecision( 9 ) << fixed << "vec3( " << inverse.offset[0] << ", " << inverse.offset[1] << ", "
+      << inverse.offset[2] << " )";
+  return out.str();
+}
+
+}
+
+string colorimetry_name( const Colorimetry colorimetry )
+{
+  string name;
+  switch ( colorimetry.matrix ) {
+    case ColorMatrix::BT601:
+      name = "BT.601";
+      break;
+    case ColorMatrix::BT709:
+      name = "BT.709";
+      break;
+    case ColorMatrix::BT2020:
+      name = "BT.2020";
+      break;
+  }
+
+  return name + ( colorimetry.range == ColorRange::Limited ? " limited range" : " full range" );
+}
+
+string glsl_ycbcr_to_rgb( const Colorimetry colorimetry )
+{
+  const InverseCoefficients inverse = inverse_coefficients( colorimetry.matrix, colorimetry.range );
+
+  return "/* " + colorimetry_name( colorimetry ) + " */\n"
+         + "vec3 ycbcr_to_rgb( vec3 ycbcr )\n{\n  return " + glsl_matrix( inverse ) + " * ycbcr + "
+         + glsl_offset( inverse ) + ";\n}\n";
+}
+
+string glsl_ycbcr_to_rgb_table()
+{
+  string matrices, offsets;
+  for ( unsigned int i = 0; i < COLORIMETRY_VARIANTS; i++ ) {
+    const Colorimetry c = colorimetry_variant( i );
+    const InverseCoefficients inverse = inverse_coefficients( c.matrix, c.range );
+    const string separator = i + 1 < COLORIMETRY_VARIANTS ? ",\n" : "\n";
+
+    matrices += "  " + glsl_matrix( inverse ) + separator;
+    offsets += "  " + glsl_offset( inverse ) + separator;
+  }
+
+  const string count = to_string( COLORIMETRY_VARIANTS );
+
+  return "const mat3 ycbcr_matrices[" + count + "] = mat3[" + count + "](\n" + matrices + ");\n\n"
+         + "const vec3 ycbcr_offsets[" + count + "] = vec3[" + count + "](\n" + offsets + ");\n\n"
+         + "vec3 ycbcr_to_rgb( vec3 ycbcr, int variant )\n{\n"
+         + "  return ycbcr_matrices[variant] * ycbcr + ycbcr_offsets[variant];\n}\n";
+}
+
+string glsl_normalize_samples( const unsigned int bit_depth )
+{
+  if ( bit_depth == 8 ) {
+    return "vec3 normalize_samples( vec3 samples )\n{\n  return samples;\n}\n";
+  }
+
+  if ( bit_depth < 9 or bit_depth > 16 ) {
+    throw runtime_error( "unsupported bit depth " + to_string( bit_depth ) );
+  }
+
+  /* a 16-bit texture returns sample / 65535 */
+  const double scale = 65535.0 / ( 255 << ( bit_depth - 8 ) );
+
+  ostringstream out;
+  out << setprecision( 9 ) << fixed << "/* " << bit_depth << "-bit samples */\n"
+      << "vec3 normalize_samples( vec3 samples )\n{\n  return samples * " << scale << ";\n}\n";
+  return out.str();
+}
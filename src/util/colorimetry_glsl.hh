@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+
+#include "colorimetry.hh"
+
+/* GLSL for Y'CbCr -> RGB conversion, generated from the tables in colorimetry.hh.
+   Both define a function for the fragment shader, on samples normalized to 0..1:
+
+     vec3 ycbcr_to_rgb( vec3 ycbcr )                -- one colorimetry, as constants
+     vec3 ycbcr_to_rgb( vec3 ycbcr, int variant )   -- any, by colorimetry_index()
+
+   The result is not clamped. */
+
+std::string glsl_ycbcr_to_rgb( const Colorimetry colorimetry );
+std::string glsl_ycbcr_to_rgb_table();
+
+/* vec3 normalize_samples( vec3 samples ) -- scales samples of `bit_depth` bits, read from a
+   16-bit (or 8-bit) texture, to the 0..1 range the matrices expect: an n-bit code value
+   counts as 2^(n-8) times the 8-bit one, as BT.709 and BT.2020 define the deeper ranges.
+   For 8-bit samples it's the identity. */
+std::string glsl_normalize_samples( const unsigned int bit_depth );
+
+std::string colorimetry_name( const Colorimetry colorimetry );
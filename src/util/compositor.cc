@@ -0,0 +1,234 @@
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+
+#include "colorimetry_glsl.hh"
+#include "compositor.hh"
+
+using namespace std;
+
+namespace {
+
+const string layer_vertex_shader_source = R"( #version 130
+
+      uniform uvec2 window_size;
+
+      in vec2 position;
+      in vec2 source_texcoord;
+      in float opacity;
+      in float is_graphics;
+      in float colorimetry;
+
+      out vec2 luma_texcoord;
+      out vec2 chroma_texcoord;
+      out float layer_opacity;
+      flat out int graphics;
+      flat out int variant;
+
+      void main()
+      {
+        gl_Position = vec4( 2 * position.x / window_size.x - 1.0,
+                            1.0 - 2 * position.y / window_size.y, 0.0, 1.0 );
+        luma_texcoord = source_texcoord;
+        chroma_texcoord = vec2( source_texcoord.x / 2 + 0.25, source_texcoord.y / 2 );
+        layer_opacity = opacity;
+        graphics = int( is_graphics );
+        variant = int( colorimetry );
+      }
+    )";
+
+/* Each picture is converted with its own colorimetry, looked up by index from a table of
+   them all, so layers with different colorimetries still share one program and one draw.
+   The output is premultiplied for blending. */
+string layer_fragment_shader_source()
+{
+  return R"( #version 130
+      #extension GL_ARB_texture_rectangle : enable
+
+      uniform sampler2DRect yTex;
+      uniform sampler2DRect uTex;
+      uniform sampler2DRect vTex;
+      uniform sampler2DRect graphicsTex;
+
+      in vec2 luma_texcoord;
+      in vec2 chroma_texcoord;
+      in float layer_opacity;
+      flat in int graphics;
+      flat in int variant;
+      out vec4 outColor;
+)" + glsl_ycbcr_to_rgb_table()
+         + R"(
+      void main()
+      {
+        if ( graphics != 0 ) {
+          outColor = texture(graphicsTex, luma_texcoord) * layer_opacity;
+          return;
+        }
+
+        float fY = texture(yTex, luma_texcoord).r;
+        float fCb = texture(uTex, chroma_texcoord).r;
+        float fCr = texture(vTex, chroma_texcoord).r;
+
+        vec3 rgb = clamp( ycbcr_to_rgb( vec3( fY, fCb, fCr ), variant ), 0.0, 1.0 );
+
+        outColor = vec4( rgb * layer_opacity, layer_opacity );
+      }
+    )";
+}
+
+}
+
+Compositor::Compositor( ShaderBuilder& builder )
+  : builder_( builder )
+{
+  builder_.add( program_, layer_vertex_shader_source, layer_fragment_shader_source() );
+}
+
+void Compositor::prepare()
+{
+  builder_.finish( program_ );
+  glCheck( "after linking compositor program" );
+
+  vertex_array_.bind();
+  ArrayBuffer::bind( vertex_buffer_ );
+
+  const GLint position = program_.attribute_location( "position" );
+  const GLint texcoord = program_.attribute_location( "source_texcoord" );
+  const GLint opacity = program_.attribute_location( "opacity" );
+  const GLint is_graphics = program_.attribute_location( "is_graphics" );
+  const GLint colorimetry = program_.attribute_location( "colorimetry" );
+
+  glVertexAttribPointer( position, 2, GL_FLOAT, GL_FALSE, sizeof( LayerVertex ), 0 );
+  glVertexAttribPointer(
+    texcoord, 2, GL_FLOAT, GL_FALSE, sizeof( LayerVertex ), (const void*)( offsetof( LayerVertex, u ) ) );
+  glVertexAttribPointer(
+    opacity, 1, GL_FLOAT, GL_FALSE, sizeof( LayerVertex ), (const void*)( offsetof( LayerVertex, opacity ) ) );
+  glVertexAttribPointer( is_graphics,
+                         1,
+                         GL_FLOAT,
+                         GL_FALSE,
+                         sizeof( LayerVertex ),
+                         (const void*)( offsetof( LayerVertex, is_graphics ) ) );
+  glVertexAttribPointer( colorimetry,
+                         1,
+                         GL_FLOAT,
+                         GL_FALSE,
+                         sizeof( LayerVertex ),
+                         (const void*)( offsetof( LayerVertex, colorimetry ) ) );
+  glEnableVertexAttribArray( position );
+  glEnableVertexAttribArray( texcoord );
+  glEnableVertexAttribArray( opacity );
+  glEnableVertexAttribArray( is_graphics );
+  glEnableVertexAttribArray( colorimetry );
+
+  program_.use();
+  Uniform<GLint>( program_, "yTex" ).set( 0 );
+  Uniform<GLint>( program_, "uTex" ).set( 1 );
+  Uniform<GLint>( program_, "vTex" ).set( 2 );
+  Uniform<GLint>( program_, "graphicsTex" ).set( GRAPHICS_TEXTURE_UNIT - GL_TEXTURE0 );
+
+  window_size_.emplace( program_, "window_size" );
+
+  glCheck( "Compositor::prepare" );
+}
+
+void Compositor::render( const vector<Layer>& layers, const unsigned int window_width, const unsigned int window_height )
+{
+  /* visible layers, lowest first */
+  order_.clear();
+  for ( const auto& layer : layers ) {
+    if ( ( layer.picture != nullptr ) == ( layer.graphics != nullptr ) ) {
+      throw runtime_error( "Compositor: a layer needs exactly one of a picture or graphics" );
+    }
+
+    const Rect& d = layer.destination;
+    if ( layer.opacity <= 0 or d.width <= 0 or d.height <= 0 or d.x >= window_width or d.y >= window_height
+         or d.x + d.width <= 0 or d.y + d.height <= 0 ) {
+      continue;
+    }
+
+    order_.push_back( &layer );
+  }
+
+  if ( order_.empty() ) {
+    return;
+  }
+
+  stable_sort( order_.begin(), order_.end(), []( const Layer* a, const Layer* b ) { return a->z < b->z; } );
+
+  batch_.clear();
+  for ( const Layer* layer : order_ ) {
+    const unsigned int source_width = layer->picture ? layer->picture->Y.width() : layer->graphics->width();
+    const unsigned int source_height = layer->picture ? layer->picture->Y.height() : layer->graphics->height();
+
+    PixelRect crop = layer->crop;
+    if ( crop.width == 0 ) {
+      crop = { 0, 0, source_width, source_height };
+    }
+    if ( crop.x + crop.width > source_width or crop.y + crop.height > source_height ) {
+      throw out_of_range( "Compositor: layer crop extends outside its source" );
+    }
+
+    const Rect& d = layer->destination;
+    const float left = d.x, top = d.y, right = d.x + d.width, bottom = d.y + d.height;
+    const float u0 = crop.x, v0 = crop.y, u1 = crop.x + crop.width, v1 = crop.y + crop.height;
+    const float opacity = min( layer->opacity, 1.0f );
+    const float graphics = layer->graphics ? 1 : 0;
+    const float variant = layer->picture ? layer->picture->colorimetry.index() : 0;
+
+    batch_.insert( batch_.end(),
+                   { { left, top, u0, v0, opacity, graphics, variant },
+                     { left, bottom, u0, v1, opacity, graphics, variant },
+                     { right, bottom, u1, v1, opacity, graphics, variant },
+                     { left, top, u0, v0, opacity, graphics, variant },
+                     { right, bottom, u1, v1, opacity, graphics, variant },
+                     { right, top, u1, v0, opacity, graphics, variant } } );
+  }
+
+  if ( not ready() ) {
+    prepare();
+  }
+
+  program_.use();
+  window_size_->set( { window_width, window_height } );
+
+  vertex_array_.bind();
+  ArrayBuffer::bind( vertex_buffer_ );
+  ArrayBuffer::load( batch_, GL_STREAM_DRAW );
+
+  glEnable( GL_BLEND );
+  glBlendFunc( GL_ONE, GL_ONE_MINUS_SRC_ALPHA );
+
+  /* Pictures and graphics are on different texture units, so each kind only needs
+     rebinding when its own source changes; layers in between go in the same draw. */
+  const Texture420* bound_picture = nullptr;
+  const TextureBGRA* bound_graphics = nullptr;
+  unsigned int run_start = 0;
+
+  for ( unsigned int i = 0; i < order_.size(); i++ ) {
+    const Layer& layer = *order_[i];
+
+    if ( layer.picture ? layer.picture == bound_picture : layer.graphics == bound_graphics ) {
+      continue;
+    }
+
+    if ( i > run_start ) {
+      glDrawArrays( GL_TRIANGLES, 6 * run_start, 6 * ( i - run_start ) );
+      run_start = i;
+    }
+
+    if ( layer.picture ) {
+      layer.picture->bind();
+      bound_picture = layer.picture;
+    } else {
+      layer.graphics->bind( GRAPHICS_TEXTURE_UNIT );
+      bound_graphics = layer.graphics;
+    }
+  }
+
+  glDrawArrays( GL_TRIANGLES, 6 * run_start, 6 * ( order_.size() - run_start ) );
+
+  glDisable( GL_BLEND );
+
+  glCheck( "Compositor::render" );
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <optional>
+#include <vector>
+
+#include "damage.hh"
+#include "gl_objects.hh"
+#include "shader_builder.hh"
+
+/* Draws a stack of layers -- video pictures and premultiplied BGRA graphics -- each into
+   its own rectangle of the window, for picture-in-picture, multiviewers and overlays.
+
+   Every layer becomes six vertices carrying its destination, source crop, opacity, kind
+   and (for pictures) colorimetry, so a frame is one buffer upload and one program;
+   between layers, the only state that changes is the texture binding, and even that is
+   skipped when consecutive layers share a source. Layers are drawn from the lowest z up
+   (in the order given, for equal z), each blended over those below it.
+
+   Pictures are 8-bit planar (Texture420) only; 10- to 16-bit and NV12 pictures can be
+   shown full-window through VideoDisplay::draw(), but not layered. */
+class Compositor
+{
+public:
+  struct Rect
+  {
+    float x, y, width, height;
+  };
+
+  struct Layer
+  {
+    /* exactly one of these is the source (pictures: 8-bit planar only, see above) */
+    const Texture420* picture = nullptr;
+    const TextureBGRA* graphics = nullptr;
+
+    Rect destination { 0, 0, 0, 0 }; /* in window pixels, from the top left */
+    int z = 0;
+    float opacity = 1.0;
+
+    /* the part of the source to show, in (luma) pixels; zero width means all of it */
+    PixelRect crop { 0, 0, 0, 0 };
+  };
+
+private:
+  struct LayerVertex
+  {
+    float x, y;       /* window pixels */
+    float u, v;       /* luma (or graphics) texels */
+    float opacity;
+    float is_graphics;
+    float colorimetry; /* the picture's colorimetry_index() */
+  };
+
+  ShaderBuilder& builder_;
+  Program program_ {};
+  VertexArrayObject vertex_array_ {};
+  VertexBufferObject vertex_buffer_ {};
+  std::optional<Uniform<glsl::uvec2>> window_size_ {};
+
+  /* the rest of the setup, once the program has been built */
+  void prepare();
+
+  /* reused from frame to frame */
+  std::vector<const Layer*> order_ {};
+  std::vector<LayerVertex> batch_ {};
+
+public:
+  /* Must be called with the GL context current. The program is built on `builder`,
+     which must outlive the compositor; the first render() waits for it if need be. */
+  explicit Compositor( ShaderBuilder& builder );
+
+  bool ready() const { return window_size_.has_value(); }
+
+  /* draw the visible layers into the current framebuffer, which is `window_width` by `window_height` */
+  void render( const std::vector<Layer>& layers, const unsigned int window_width, const unsigned int window_height );
+
+  /* units 0-2 hold a layer's picture; graphics use this one */
+  static constexpr GLenum GRAPHICS_TEXTURE_UNIT = GL_TEXTURE4;
+
+  /* forbid copy */
+  Compositor( const Compositor& other ) = delete;
+  Compositor& operator=( const Compositor& other ) = delete;
+};
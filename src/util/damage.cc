@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "damage.hh"
+
+using namespace std;
+
+TileDamage::TileDamage( const unsigned int width, const unsigned int height, const unsigned int tile_size )
+  : width_( width )
+  , height_( height )
+  , tile_size_( tile_size )
+  , columns_( 0 )
+  , rows_( 0 )
+  , dirty_()
+{
+  if ( tile_size == 0 or tile_size % 2 ) {
+    throw runtime_error( "damage tile size must be even" );
+  }
+
+  columns_ = ( width + tile_size - 1 ) / tile_size;
+  rows_ = ( height + tile_size - 1 ) / tile_size;
+  dirty_.resize( columns_ * rows_ );
+
+  add_all();
+}
+
+void TileDamage::mark( const unsigned int column, const unsigned int row )
+{
+  const unsigned int index = row * columns_ + column;
+  if ( not dirty_[index] ) {
+    dirty_[index] = true;
+    dirty_count_++;
+  }
+}
+
+void TileDamage::add( const double x1, const double y1, const double x2, const double y2 )
+{
+  /* a pixel of margin for antialiasing, then clip */
+  const double left = max( floor( min( x1, x2 ) ) - 1, 0.0 );
+  const double top = max( floor( min( y1, y2 ) ) - 1, 0.0 );
+  const double right = min( ceil( max( x1, x2 ) ) + 1, double( width_ ) );
+  const double bottom = min( ceil( max( y1, y2 ) ) + 1, double( height_ ) );
+
+  if ( not( left < right and top < bottom ) ) {
+    return; /* empty, entirely outside, or NaN */
+  }
+
+  const unsigned int first_column = unsigned( left ) / tile_size_;
+  const unsigned int end_column = ( unsigned( right ) + tile_size_ - 1 ) / tile_size_;
+  const unsigned int first_row = unsigned( top ) / tile_size_;
+  const unsigned int end_row = ( unsigned( bottom ) + tile_size_ - 1 ) / tile_size_;
+
+  for ( unsigned int row = first_row; row < end_row; row++ ) {
+    for ( unsigned int column = first_column; column < end_column; column++ ) {
+      mark( column, row );
+    }
+  }
+}
+
+void TileDamage::add_all()
+{
+  fill( dirty_.begin(), dirty_.end(), true );
+  dirty_count_ = dirty_.size();
+}
+
+void TileDamage::clear()
+{
+  fill( dirty_.begin(), dirty_.end(), false );
+  dirty_count_ = 0;
+}
+
+vector<PixelRect> TileDamage::rectangles() const
+{
+  vector<PixelRect> result;
+  if ( empty() ) {
+    return result;
+  }
+
+  /* rectangles that reach the bottom of the previous row, which an identical run extends */
+  vector<PixelRect> open, still_open;
+
+  /* tiles on the right and bottom edges are clipped to the image */
+  for ( unsigned int row = 0; row < rows_; row++ ) {
+    const unsigned int y = row * tile_size_;
+    const unsigned int height = min( y + tile_size_, height_ ) - y;
+
+    for ( unsigned int column = 0; column < columns_; ) {
+      if ( not dirty_[row * columns_ + column] ) {
+        column++;
+        continue;
+      }
+
+      const unsigned int x = column * tile_size_;
+      while ( column < columns_ and dirty_[row * columns_ + column] ) {
+        column++;
+      }
+      const unsigned int width = min( column * tile_size_, width_ ) - x;
+
+      const auto above
+        = find_if( open.begin(), open.end(), [&]( const PixelRect& r ) { return r.x == x and r.width == width; } );
+
+      if ( above != open.end() ) {
+        still_open.push_back( { x, above->y, width, above->height + height } );
+        open.erase( above );
+      } else {
+        still_open.push_back( { x, y, width, height } );
+      }
+    }
+
+    /* anything not extended by this row is finished */
+    result.insert( result.end(), open.begin(), open.end() );
+    open.swap( still_open );
+    still_open.clear();
+  }
+
+  result.insert( result.end(), open.begin(), open.end() );
+  return result;
+}
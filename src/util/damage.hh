@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>
+
+struct PixelRect
+{
+  unsigned int x, y, width, height;
+};
+
+/* Which parts of an image have changed since it was last copied somewhere, to a
+   resolution of square tiles (16 or 64 pixels on a side is typical).
+
+   Damage is added as device-space bounding boxes, padded by a pixel for antialiasing.
+   rectangles() returns the dirty tiles merged into as few rectangles as is cheap to find:
+   runs of adjacent dirty tiles along a row, then identical runs in consecutive rows.
+   Every rectangle starts at an even position and has an even size, except where it meets
+   an odd right or bottom edge of the image, which it covers too. */
+class TileDamage
+{
+  unsigned int width_, height_, tile_size_;
+  unsigned int columns_, rows_;
+  std::vector<bool> dirty_;
+  unsigned int dirty_count_ = 0;
+
+  void mark( const unsigned int column, const unsigned int row );
+
+public:
+  /* starts with everything dirty; `tile_size` must be even */
+  TileDamage( const unsigned int width, const unsigned int height, const unsigned int tile_size = 64 );
+
+  /* the box from (x1, y1) to (x2, y2), in pixels; clipped to the image */
+  void add( const double x1, const double y1, const double x2, const double y2 );
+  void add_all();
+  void clear();
+
+  bool empty() const { return dirty_count_ == 0; }
+  unsigned int dirty_tiles() const { return dirty_count_; }
+  unsigned int tile_size() const { return tile_size_; }
+
+  std::vector<PixelRect> rectangles() const;
+};
@@ -26,16 +26,41 @@
    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
 
+#include <iostream>
+
+#include "colorimetry_glsl.hh"
 #include "display.hh"
+#include "text_renderer.hh"
 
 using namespace std;
+using namespace std::chrono;
+
+namespace {
+
+/* enough for the GPU to run a few frames behind without stalling the readback */
+constexpr unsigned int GPU_TIMER_COUNT = 4;
+
+double milliseconds_between( const steady_clock::time_point start, const steady_clock::time_point end )
+{
+  return duration<double, milli>( end - start ).count();
+}
 
-const string VideoDisplay::shader_source_scale_from_pixel_coordinates = R"( #version 130
+}
 
-      uniform uvec2 window_size;
+/* per-frame parameters are one uniform block, shared by both stages and updated in one upload */
+const string VideoDisplay::shader_source_scale_from_pixel_coordinates = R"( #version 140
+      #extension GL_ARB_explicit_attrib_location : require
 
-      in vec2 position;
-      in vec2 chroma_texcoord;
+      layout(std140) uniform DisplayParameters
+      {
+        vec2 test_uniform;
+        uvec2 window_size;
+        bool has_overlay;
+      };
+
+      /* fixed locations, so one vertex array serves the program for every colorimetry */
+      layout(location = 0) in vec2 position;
+      layout(location = 1) in vec2 chroma_texcoord;
       out vec2 raw_position;
       out vec2 uv_texcoord;
 
@@ -48,104 +73,164 @@ const string VideoDisplay::shader_source_scale_from_pixel_coordinates = R"( #ver
       }
     )";
 
-/* octave> 255 * inv([219*[.7152 .0722 .2126]'
-                      224*[-0.38542789394266 .5 -0.11457210605734]'
-                      224*[-0.454152908305817 -0.0458470916941834 .5]']') */
-
-/* switched to SMPTE 170M matrix (1/21/2017)
->> 255 * inv([219*[.587 .114 .299]' 224*[-.331 .500 -.169]' 224*[-.419 -.081 .5]']')
-ans =
+/* the Y'CbCr -> RGB matrix and the sample normalization are generated (see colorimetry_glsl.hh),
+   and NV12 pictures read both chroma samples from one texture */
+string VideoDisplay::shader_source_ycbcr( const PictureFormat& format )
+{
+  const string chroma_samplers = format.semi_planar ? "uniform sampler2DRect uTex; /* Cb, Cr */"
+                                                    : "uniform sampler2DRect uTex;\n"
+                                                      "      uniform sampler2DRect vTex;";
 
-      1.16438356164384    -0.391260370716072    -0.813004933873461
-      1.16438356164384      2.01741475897078   0.00112725996069348
-      1.16438356164384  -0.00105499970680283      1.59567019581339
-*/
+  const string chroma_fetch = format.semi_planar ? "vec2 fCbCr = texture(uTex, uv_texcoord).rg;\n"
+                                                   "        float fCb = fCbCr.r, fCr = fCbCr.g;"
+                                                 : "float fCb = texture(uTex, uv_texcoord).r;\n"
+                                                   "        float fCr = texture(vTex, uv_texcoord).r;";
 
-const string VideoDisplay::shader_source_ycbcr = R"( #version 130
-      #extension GL_ARB_texture_rectangle : enable
+  return R"( #version 140
 
       precision mediump float;
 
-      uniform vec2 test_uniform;
+      layout(std140) uniform DisplayParameters
+      {
+        vec2 test_uniform;
+        uvec2 window_size;
+        bool has_overlay;
+      };
 
       uniform sampler2DRect yTex;
-      uniform sampler2DRect uTex;
-      uniform sampler2DRect vTex;
+      )" + chroma_samplers + R"(
+
+      /* premultiplied RGBA, composited over the video when has_overlay is set */
+      uniform sampler2DRect overlayTex;
 
       in vec2 uv_texcoord;
       in vec2 raw_position;
       out vec4 outColor;
-
+)" + glsl_normalize_samples( format.bit_depth )
+         + glsl_ycbcr_to_rgb( format.colorimetry ) + R"(
       void main()
       {
-        float fY = texture(yTex, raw_position + test_uniform).x;
-        float fCb = texture(uTex, uv_texcoord).x;
-        float fCr = texture(vTex, uv_texcoord).x;
-
-        outColor = vec4(
-          max(0, min(1.0, 1.16438356164384 * (fY - 0.06274509803921568627) + 1.59567019581339  * (fCr - 0.50196078431372549019))),
-          max(0, min(1.0, 1.16438356164384 * (fY - 0.06274509803921568627) - 0.391260370716072 * (fCb - 0.50196078431372549019) - 0.813004933873461 * (fCr - 0.50196078431372549019))),
-          max(0, min(1.0, 1.16438356164384 * (fY - 0.06274509803921568627) + 2.01741475897078  * (fCb - 0.50196078431372549019))),
-          1.0
-        );
+        float fY = texture(yTex, raw_position + test_uniform).r;
+        )" + chroma_fetch + R"(
+
+        vec3 video = clamp( ycbcr_to_rgb( normalize_samples( vec3( fY, fCb, fCr ) ) ), 0.0, 1.0 );
+
+        if ( has_overlay ) {
+          vec4 overlay = texture(overlayTex, raw_position);
+          video = overlay.rgb + video * (1.0 - overlay.a);
+        }
+
+        outColor = vec4( video, 1.0 );
       }
     )";
+}
 
 VideoDisplay::CurrentContextWindow::CurrentContextWindow( const unsigned int width,
                                                           const unsigned int height,
                                                           const string& title,
-                                                          const bool fullscreen )
-  : window_( width, height, title, fullscreen )
+                                                          const DisplayMode mode )
+  : glfw_context_( mode == DisplayMode::Offscreen )
+  , window_( width, height, title, mode == DisplayMode::Fullscreen, mode != DisplayMode::Offscreen )
 {
   window_.make_context_current();
 }
 
 VideoDisplay::VideoDisplay( const unsigned int width, const unsigned int height, const bool fullscreen )
+  : VideoDisplay( width, height, fullscreen ? DisplayMode::Fullscreen : DisplayMode::Windowed )
+{}
+
+VideoDisplay::VideoDisplay( const unsigned int width, const unsigned int height, const DisplayMode mode )
   : width_( width )
   , height_( height )
-  , current_context_window_( width_, height_, "OpenGL Example", fullscreen )
+  , current_context_window_( width_, height_, "OpenGL Example", mode )
+  , gpu_timers_( GLEW_ARB_timer_query ? GPU_TIMER_COUNT : 0 )
+  , offscreen_( mode == DisplayMode::Offscreen ? make_unique<OffscreenTarget>() : nullptr )
 {
-  texture_shader_program_.attach( scale_from_pixel_coordinates_ );
-  texture_shader_program_.attach( ycbcr_shader_ );
-  texture_shader_program_.link();
-  glCheck( "after linking texture shader program" );
+  for ( unsigned int i = 0; i < COLORIMETRY_VARIANTS; i++ ) {
+    const PictureFormat format { colorimetry_variant( i ) };
+    shader_builder_.add( texture_shaders_[format.key()].program,
+                         shader_source_scale_from_pixel_coordinates,
+                         shader_source_ycbcr( format ) );
+  }
+  compositor_ = make_unique<Compositor>( shader_builder_ );
+  texture_shader_program( format_ );
 
+  /* the locations are fixed by the vertex shader */
   texture_shader_array_object_.bind();
   ArrayBuffer::bind( screen_corners_ );
-  glVertexAttribPointer(
-    texture_shader_program_.attribute_location( "position" ), 2, GL_FLOAT, GL_FALSE, sizeof( VertexObject ), 0 );
-  glEnableVertexAttribArray( texture_shader_program_.attribute_location( "position" ) );
+  glVertexAttribPointer( 0, 2, GL_FLOAT, GL_FALSE, sizeof( VertexObject ), 0 );
+  glEnableVertexAttribArray( 0 );
+  glVertexAttribPointer( 1, 2, GL_FLOAT, GL_FALSE, sizeof( VertexObject ), (const void*)( 2 * sizeof( float ) ) );
+  glEnableVertexAttribArray( 1 );
+
+  if ( offscreen_ ) {
+    /* the virtual output size is whatever was asked for */
+    window().set_swap_interval( 0 );
+    offscreen_->framebuffer.bind();
+    offscreen_->color.allocate( GL_RGBA8, width_, height_ );
+    offscreen_->framebuffer.attach_color( offscreen_->color );
+    resize( width_, height_ );
+  } else {
+    const auto window_size = window().framebuffer_size();
+    resize( window_size.first, window_size.second );
+  }
 
-  glVertexAttribPointer( texture_shader_program_.attribute_location( "chroma_texcoord" ),
-                         2,
-                         GL_FLOAT,
-                         GL_FALSE,
-                         sizeof( VertexObject ),
-                         (const void*)( 2 * sizeof( float ) ) );
-  glEnableVertexAttribArray( texture_shader_program_.attribute_location( "chroma_texcoord" ) );
+  glCheck( "VideoDisplay constructor" );
+}
 
-  const auto window_size = window().framebuffer_size();
-  resize( window_size.first, window_size.second );
+unsigned int VideoDisplay::PictureFormat::key() const
+{
+  return ( bit_depth * 2 + semi_planar ) * COLORIMETRY_VARIANTS + colorimetry.index();
+}
 
-  glCheck( "VideoDisplay constructor" );
+/* submit the program if it's the first of its kind, wait for it to be built if need be,
+   and set it up the first time */
+Program& VideoDisplay::texture_shader_program( const PictureFormat& format )
+{
+  const unsigned int key = format.key();
+
+  if ( not texture_shaders_.count( key ) ) {
+    const string fragment_source = shader_source_ycbcr( format );
+    shader_builder_.add(
+      texture_shaders_[key].program, shader_source_scale_from_pixel_coordinates, fragment_source );
+  }
+
+  TextureShader& shader = texture_shaders_.at( key );
+  Program& program = shader.program;
+
+  if ( shader.prepared ) {
+    return program;
+  }
+
+  shader_builder_.finish( program );
+  glCheck( "after linking texture shader program" );
+
+  program.use();
+  Uniform<GLint>( program, "yTex" ).set( 0 );
+  Uniform<GLint>( program, "uTex" ).set( 1 );
+  if ( not format.semi_planar ) {
+    Uniform<GLint>( program, "vTex" ).set( 2 );
+  }
+  Uniform<GLint>( program, "overlayTex" ).set( OVERLAY_TEXTURE_UNIT - GL_TEXTURE0 );
+
+  program.bind_uniform_block( "DisplayParameters", parameters_buffer_, PARAMETERS_BINDING_POINT );
+
+  shader.prepared = true;
+  return program;
 }
 
 void VideoDisplay::set_test_uniform( const float x, const float y )
 {
-  texture_shader_program_.use();
-  glUniform2f( texture_shader_program_.uniform_location( "test_uniform" ), x, y );
+  parameters_.test_uniform = { x, y };
+  parameters_changed_ = true;
 }
 
 void VideoDisplay::resize( const unsigned int width, const unsigned int height )
 {
   glViewport( 0, 0, width, height );
 
-  texture_shader_program_.use();
-  glUniform2ui( texture_shader_program_.uniform_location( "window_size" ), width, height );
-
-  glUniform1i( texture_shader_program_.uniform_location( "yTex" ), 0 );
-  glUniform1i( texture_shader_program_.uniform_location( "uTex" ), 1 );
-  glUniform1i( texture_shader_program_.uniform_location( "vTex" ), 2 );
+  parameters_.window_size = { width, height };
+  parameters_changed_ = true;
 
   const float xoffset = 0.25;
 
@@ -163,35 +248,196 @@ void VideoDisplay::resize( const unsigned int width, const unsigned int height )
 
   glCheck( "after resizing" );
 
-  const auto new_window_size = window().window_size();
-  if ( new_window_size.first != width or new_window_size.second != height ) {
-    throw runtime_error( "failed to resize window to " + to_string( width ) + "x" + to_string( height ) );
+  if ( offscreen_ ) {
+    if ( width != width_ or height != height_ ) {
+      width_ = width;
+      height_ = height;
+      offscreen_->color.allocate( GL_RGBA8, width_, height_ );
+    }
+  } else {
+    const auto new_window_size = window().window_size();
+    if ( new_window_size.first != width or new_window_size.second != height ) {
+      throw runtime_error( "failed to resize window to " + to_string( width ) + "x" + to_string( height ) );
+    }
   }
 
   ArrayBuffer::bind( screen_corners_ );
   texture_shader_array_object_.bind();
-  texture_shader_program_.use();
+  texture_shader_program( format_ ).use();
 
   glCheck( "after installing shaders" );
 }
 
-void VideoDisplay::draw( Texture420& image )
+template<typename Sample>
+void VideoDisplay::draw( BasicTexture420<Sample>& image, const TextureBGRA* overlay, TextRenderer* text )
+{
+  if ( image.bit_depth > 8 * sizeof( Sample ) or ( sizeof( Sample ) > 1 and image.bit_depth <= 8 ) ) {
+    throw runtime_error( "VideoDisplay: unsupported bit depth " + to_string( image.bit_depth ) + " for "
+                         + to_string( 8 * sizeof( Sample ) ) + "-bit texture" );
+  }
+
+  image.bind();
+  format_ = { image.colorimetry, image.bit_depth, false };
+  repaint( overlay, text, nullptr );
+}
+
+template void VideoDisplay::draw( Texture420& image, const TextureBGRA* overlay, TextRenderer* text );
+template void VideoDisplay::draw( Texture420_16& image, const TextureBGRA* overlay, TextRenderer* text );
+
+void VideoDisplay::draw( TextureNV12& image, const TextureBGRA* overlay, TextRenderer* text )
 {
   image.bind();
-  repaint();
+  format_ = { image.colorimetry, 8, true };
+  repaint( overlay, text, nullptr );
+}
+
+void VideoDisplay::draw( const vector<Compositor::Layer>& layers, TextRenderer* text )
+{
+  repaint( nullptr, text, &layers );
 }
 
 void VideoDisplay::repaint()
 {
-  const auto window_size = window().window_size();
+  repaint( nullptr, nullptr, nullptr );
+}
 
-  if ( window_size.first != width_ or window_size.second != height_ ) {
-    width_ = window_size.first;
-    height_ = window_size.second;
-    resize( width_, height_ );
+void VideoDisplay::repaint( const TextureBGRA* overlay, TextRenderer* text, const vector<Compositor::Layer>* layers )
+{
+  if ( not offscreen_ ) {
+    const auto window_size = window().window_size();
+
+    if ( window_size.first != width_ or window_size.second != height_ ) {
+      width_ = window_size.first;
+      height_ = window_size.second;
+      resize( width_, height_ );
+    }
+  }
+
+  collect_gpu_times();
+
+  /* finish any programs the driver has built meanwhile (a no-op once they're all done) */
+  if ( shader_builder_.pending_count() ) {
+    shader_builder_.poll();
+  }
+
+  const auto submit_start = steady_clock::now();
+
+  /* if the GPU is so far behind that every query is still outstanding, this frame goes untimed */
+  TimerQuery* timer = nullptr;
+  if ( not gpu_timers_.empty() and not gpu_timers_.at( next_gpu_timer_ ).pending() ) {
+    timer = &gpu_timers_.at( next_gpu_timer_ );
+    next_gpu_timer_ = ( next_gpu_timer_ + 1 ) % gpu_timers_.size();
+    timer->begin();
+  }
+
+  if ( layers ) {
+    glClearColor( 0, 0, 0, 1 );
+    glClear( GL_COLOR_BUFFER_BIT );
+    compositor_->render( *layers, width_, height_ );
+  } else {
+    texture_shader_array_object_.bind();
+    texture_shader_program( format_ ).use();
+
+    if ( overlay ) {
+      overlay->bind( OVERLAY_TEXTURE_UNIT );
+    }
+    if ( parameters_.has_overlay != ( overlay != nullptr ) ) {
+      parameters_.has_overlay = ( overlay != nullptr );
+      parameters_changed_ = true;
+    }
+
+    /* everything that changed since the last frame goes up in one upload */
+    if ( parameters_changed_ ) {
+      parameters_buffer_.update( parameters_ );
+      parameters_changed_ = false;
+    }
+
+    glDrawArrays( GL_TRIANGLE_FAN, 0, 4 );
+  }
+
+  if ( text ) {
+    text->render( width_, height_ );
+  }
+
+  if ( timer ) {
+    timer->end();
+  }
+
+  if ( capture_ ) {
+    capture_->poll();
+    capture_->read( width_, height_, frame_number_ );
+  }
+  frame_number_++;
+
+  const auto swap_start = steady_clock::now();
+  present();
+  const auto swap_end = steady_clock::now();
+
+  statistics_.record( FrameStatistics::Metric::Submit, milliseconds_between( submit_start, swap_start ) );
+  statistics_.record( FrameStatistics::Metric::Swap, milliseconds_between( swap_start, swap_end ) );
+
+  if ( last_swap_ != steady_clock::time_point {} ) {
+    statistics_.record( FrameStatistics::Metric::Interval, milliseconds_between( last_swap_, swap_end ) );
+
+    if ( summary_interval_ and statistics_.frame_count() % summary_interval_ == 0 ) {
+      cout << statistics_.summary_line() << "\n";
+    }
+  }
+  last_swap_ = swap_end;
+}
+
+void VideoDisplay::present()
+{
+  if ( not offscreen_ ) {
+    current_context_window_.window_.swap_buffers();
+    return;
   }
 
-  glDrawArrays( GL_TRIANGLE_FAN, 0, 4 );
+  /* keep the CPU at most two frames ahead of the GPU */
+  Fence& frame_complete = offscreen_->frames_in_flight.at( offscreen_->next_frame );
+  frame_complete.wait();
+  frame_complete.insert();
+  offscreen_->next_frame = ( offscreen_->next_frame + 1 ) % offscreen_->frames_in_flight.size();
+}
+
+vector<uint8_t> VideoDisplay::read_rgba()
+{
+  /* a window's back buffer is undefined once it has been swapped; use start_capture() there */
+  if ( not offscreen_ ) {
+    throw runtime_error( "VideoDisplay::read_rgba is only available in offscreen mode" );
+  }
+
+  vector<uint8_t> pixels( size_t( width_ ) * height_ * 4 );
+
+  glPixelStorei( GL_PACK_ALIGNMENT, 1 );
+  glReadPixels( 0, 0, width_, height_, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data() );
+  glCheck( "VideoDisplay::read_rgba" );
 
-  current_context_window_.window_.swap_buffers();
+  return pixels;
+}
+
+FrameCapture& VideoDisplay::start_capture( const CaptureFormat format, FrameCapture::Callback callback )
+{
+  stop_capture();
+  capture_ = make_unique<FrameCapture>( format, move( callback ) );
+  return *capture_;
+}
+
+void VideoDisplay::stop_capture()
+{
+  if ( capture_ ) {
+    capture_->flush();
+    capture_.reset();
+  }
+}
+
+void VideoDisplay::collect_gpu_times()
+{
+  /* starting from the oldest, take every result the GPU has finished */
+  for ( unsigned int i = 0; i < gpu_timers_.size(); i++ ) {
+    TimerQuery& timer = gpu_timers_.at( ( next_gpu_timer_ + i ) % gpu_timers_.size() );
+    if ( timer.result_available() ) {
+      statistics_.record( FrameStatistics::Metric::GPU, timer.nanoseconds() / 1.0e6 );
+    }
+  }
 }
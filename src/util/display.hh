@@ -31,48 +31,171 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
+#include <array>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "colorimetry.hh"
+#include "compositor.hh"
+#include "frame_capture.hh"
+#include "frame_statistics.hh"
 #include "gl_objects.hh"
+#include "shader_builder.hh"
+
+class TextRenderer;
+
+enum class DisplayMode
+{
+  Windowed,
+  Fullscreen,
+  Offscreen /* no visible window: render into a framebuffer object of the requested size */
+};
 
 class VideoDisplay
 {
 private:
   static const std::string shader_source_scale_from_pixel_coordinates;
-  static const std::string shader_source_ycbcr;
+  /* what the full-window program needs to know about the picture; one program for each */
+  struct PictureFormat
+  {
+    Colorimetry colorimetry {};
+    unsigned int bit_depth = 8;
+    bool semi_planar = false; /* NV12: Cb and Cr interleaved in one texture */
+
+    unsigned int key() const;
+  };
+
+  static std::string shader_source_ycbcr( const PictureFormat& format );
 
   unsigned int width_, height_;
 
   struct CurrentContextWindow
   {
-    GLFWContext glfw_context_ = {};
+    GLFWContext glfw_context_;
     Window window_;
 
     CurrentContextWindow( const unsigned int width,
                           const unsigned int height,
                           const std::string& title,
-                          const bool fullscreen );
+                          const DisplayMode mode );
   } current_context_window_;
 
-  VertexShader scale_from_pixel_coordinates_ = { shader_source_scale_from_pixel_coordinates };
-  FragmentShader ycbcr_shader_ = { shader_source_ycbcr };
+  /* Every program is submitted at construction, including one full-window program per
+     colorimetry for 8-bit pictures; only the default colorimetry's is waited for, and each
+     of the others the first time a picture needs it. Programs for deeper pictures are
+     built when the first one is drawn. */
+  struct TextureShader
+  {
+    Program program {};
+    bool prepared = false;
+  };
 
-  Program texture_shader_program_ = {};
+  ShaderBuilder shader_builder_ {};
+  std::map<unsigned int, TextureShader> texture_shaders_ {}; /* by PictureFormat::key() */
+  PictureFormat format_ {};                                  /* of the picture being drawn */
 
   VertexArrayObject texture_shader_array_object_ = {};
   VertexBufferObject screen_corners_ = {};
   VertexBufferObject other_vertices_ = {};
 
+  /* frame timing; GPU times are read back from a ring of queries once the GPU catches up */
+  FrameStatistics statistics_ = {};
+  std::vector<TimerQuery> gpu_timers_;
+  unsigned int next_gpu_timer_ = 0;
+  std::chrono::steady_clock::time_point last_swap_ = {};
+  unsigned int summary_interval_ = 0;
+
+  /* Offscreen mode draws into this instead of the window, and nothing throttles the
+     frame rate except a cap on the number of frames the GPU may fall behind. */
+  struct OffscreenTarget
+  {
+    Renderbuffer color {};
+    Framebuffer framebuffer {};
+    std::array<Fence, 2> frames_in_flight {};
+    unsigned int next_frame = 0;
+  };
+  std::unique_ptr<OffscreenTarget> offscreen_;
+
+  /* the DisplayParameters uniform block, in std140 layout */
+  struct Parameters
+  {
+    glsl::vec2 test_uniform;
+    glsl::uvec2 window_size;
+    GLint has_overlay;
+    GLint padding[3];
+  };
+
+  static constexpr GLuint PARAMETERS_BINDING_POINT = 0;
+
+  Parameters parameters_ { { 0, 0 }, { 0, 0 }, 0, {} };
+  UniformBuffer<Parameters> parameters_buffer_ {};
+  bool parameters_changed_ = true;
+
+  /* built in the background, and waited for (if need be) the first time layers are drawn */
+  std::unique_ptr<Compositor> compositor_ {};
+
+  std::unique_ptr<FrameCapture> capture_ {};
+  uint64_t frame_number_ = 0;
+
+  Program& texture_shader_program( const PictureFormat& format );
+  void collect_gpu_times();
+  void present();
+
+  /* draw the bound picture, or `layers` if given, then `overlay` and `text` over it */
+  void repaint( const TextureBGRA* overlay, TextRenderer* text, const std::vector<Compositor::Layer>* layers );
+
 public:
   VideoDisplay( const unsigned int width, const unsigned int height, const bool fullscreen = false );
+  VideoDisplay( const unsigned int width, const unsigned int height, const DisplayMode mode );
 
-  void draw( Texture420& image );
+  /* Converted to RGB according to image.colorimetry and image.bit_depth. A premultiplied
+     BGRA `overlay`, the size of the window, is blended over the picture in the same pass
+     (it is bound to OVERLAY_TEXTURE_UNIT), and the text queued on `text` over that. */
+  template<typename Sample>
+  void draw( BasicTexture420<Sample>& image, const TextureBGRA* overlay = nullptr, TextRenderer* text = nullptr );
+  void draw( TextureNV12& image, const TextureBGRA* overlay = nullptr, TextRenderer* text = nullptr );
+
+  /* draw layers over black instead of one full-window picture (see Compositor) */
+  void draw( const std::vector<Compositor::Layer>& layers, TextRenderer* text = nullptr );
+
+  /* units 0-2 hold the video and 3 the glyph atlas */
+  static constexpr GLenum OVERLAY_TEXTURE_UNIT = GL_TEXTURE4;
   void repaint();
   void resize( const unsigned int width, const unsigned int height );
 
+  bool offscreen() const { return offscreen_ != nullptr; }
+  unsigned int width() const { return width_; }
+  unsigned int height() const { return height_; }
+
+  /* Offscreen mode only: wait for rendering to finish and copy the last frame drawn (bottom
+     row first), 4 bytes per pixel. A window's frames can be read with start_capture(). */
+  std::vector<uint8_t> read_rgba();
+
+  /* read back every frame from now on, without waiting for the GPU; each is delivered
+     during a later repaint() to `callback`, or else to capture().pop() */
+  FrameCapture& start_capture( const CaptureFormat format, FrameCapture::Callback callback = {} );
+
+  /* deliver the frames still in flight and stop capturing */
+  void stop_capture();
+
+  FrameCapture* capture() { return capture_.get(); }
+
   Window& window() { return current_context_window_.window_; }
   const Window& window() const { return current_context_window_.window_; }
 
   void set_test_uniform( const float x, const float y );
 
+  FrameStatistics& statistics() { return statistics_; }
+  const FrameStatistics& statistics() const { return statistics_; }
+
+  /* when the most recent buffer swap returned */
+  std::chrono::steady_clock::time_point last_swap() const { return last_swap_; }
+
+  /* print the statistics summary every `frames` frames (0 to disable) */
+  void print_statistics_every( const unsigned int frames ) { summary_interval_ = frames; }
+
   /* forbid copying */
   VideoDisplay( const VideoDisplay& other ) = delete;
   VideoDisplay& operator=( const VideoDisplay& other ) = delete;
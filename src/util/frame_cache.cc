@@ -0,0 +1,139 @@
+#include <iomanip>
+#include <sstream>
+
+#include "frame_cache.hh"
+
+using namespace std;
+
+namespace {
+
+bool has_size( const Texture420& texture, const unsigned int width, const unsigned int height )
+{
+  return texture.Y.width() == width and texture.Y.height() == height;
+}
+
+}
+
+FrameCache::FrameCache( const uint64_t memory_budget )
+  : memory_budget_( memory_budget )
+{}
+
+Texture420* FrameCache::find( const uint64_t id )
+{
+  const auto found = index_.find( id );
+  if ( found == index_.end() ) {
+    misses_++;
+    return nullptr;
+  }
+
+  hits_++;
+  entries_.splice( entries_.begin(), entries_, found->second );
+  return found->second->texture.get();
+}
+
+/* a spare of the right size, else the least recently used frame if it's the right size, else new storage */
+unique_ptr<Texture420> FrameCache::texture_for( const unsigned int width, const unsigned int height )
+{
+  for ( auto it = spares_.begin(); it != spares_.end(); ++it ) {
+    if ( has_size( **it, width, height ) ) {
+      unique_ptr<Texture420> texture = move( *it );
+      spares_.erase( it );
+      recycled_++;
+      return texture;
+    }
+  }
+
+  const uint64_t needed = uint64_t( width ) * height + 2 * uint64_t( width / 2 ) * ( height / 2 );
+
+  /* make room, giving up spares of other sizes before any resident frame */
+  while ( memory_bytes_ + needed > memory_budget_ ) {
+    if ( not spares_.empty() ) {
+      memory_bytes_ -= spares_.back()->memory_bytes();
+      spares_.pop_back();
+      continue;
+    }
+
+    if ( entries_.empty() ) {
+      break; /* a single frame larger than the budget is still allowed */
+    }
+
+    Entry& victim = entries_.back();
+    unique_ptr<Texture420> texture = move( victim.texture );
+    index_.erase( victim.id );
+    entries_.pop_back();
+    evictions_++;
+
+    if ( has_size( *texture, width, height ) ) {
+      recycled_++;
+      return texture;
+    }
+
+    memory_bytes_ -= texture->memory_bytes();
+  }
+
+  auto texture = make_unique<Texture420>( width, height );
+  memory_bytes_ += texture->memory_bytes();
+  allocated_++;
+  return texture;
+}
+
+Texture420& FrameCache::insert( const uint64_t id, const ConstRaster420View& frame, const Colorimetry colorimetry )
+{
+  const unsigned int width = frame.Y.width(), height = frame.Y.height();
+
+  const auto existing = index_.find( id );
+  if ( existing != index_.end() ) {
+    if ( has_size( *existing->second->texture, width, height ) ) {
+      entries_.splice( entries_.begin(), entries_, existing->second );
+      Texture420& texture = *existing->second->texture;
+      texture.load_at_origin( frame );
+      texture.colorimetry = colorimetry;
+      return texture;
+    }
+    erase( id );
+  }
+
+  unique_ptr<Texture420> texture = texture_for( width, height );
+  texture->load_at_origin( frame );
+  texture->colorimetry = colorimetry;
+
+  entries_.push_front( { id, move( texture ) } );
+  index_.emplace( id, entries_.begin() );
+
+  return *entries_.front().texture;
+}
+
+void FrameCache::erase( const uint64_t id )
+{
+  const auto found = index_.find( id );
+  if ( found == index_.end() ) {
+    return;
+  }
+
+  spares_.push_back( move( found->second->texture ) );
+  entries_.erase( found->second );
+  index_.erase( found );
+}
+
+void FrameCache::clear()
+{
+  index_.clear();
+  entries_.clear();
+  spares_.clear();
+  memory_bytes_ = 0;
+}
+
+FrameCache::Statistics FrameCache::statistics() const
+{
+  return { hits_, misses_, evictions_, recycled_, allocated_, entries_.size(), memory_bytes_ };
+}
+
+string FrameCache::summary_line() const
+{
+  ostringstream out;
+  out << fixed << setprecision( 1 ) << "frame cache: " << entries_.size() << " frames in "
+      << memory_bytes_ / 1048576.0 << " of " << memory_budget_ / 1048576.0 << " MiB, "
+      << 100 * statistics().hit_rate() << "% hits (" << hits_ << "/" << hits_ + misses_ << "), " << evictions_
+      << " evicted, " << recycled_ << " uploads into recycled textures, " << allocated_ << " allocated";
+  return out.str();
+}
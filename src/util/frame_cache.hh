@@ -0,0 +1,87 @@
+#pragma once
+
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "gl_objects.hh"
+
+/* GPU-resident 4:2:0 frames, keyed by a caller-chosen frame id.
+
+   Frames that are shown more than once (a loop, a still, a seek back) stay uploaded, up
+   to a budget of texture memory, and the least recently used are evicted past that. An
+   evicted frame's textures are not deleted: the next frame of the same size is uploaded
+   into them, so a cache that is churning doesn't allocate texture storage. Textures of
+   other sizes are deleted only when the budget needs the room.
+
+   Like the textures it holds, the cache is only used on the thread with the GL context. */
+class FrameCache
+{
+public:
+  struct Statistics
+  {
+    uint64_t hits, misses, evictions;
+    uint64_t recycled, allocated; /* where each miss's textures came from */
+    size_t entries, memory_bytes; /* memory_bytes includes spare textures */
+
+    double hit_rate() const { return hits + misses ? hits / double( hits + misses ) : 0; }
+  };
+
+private:
+  struct Entry
+  {
+    uint64_t id;
+    std::unique_ptr<Texture420> texture;
+  };
+
+  uint64_t memory_budget_;
+
+  std::list<Entry> entries_ {}; /* most recently used first */
+  std::unordered_map<uint64_t, std::list<Entry>::iterator> index_ {};
+  std::vector<std::unique_ptr<Texture420>> spares_ {}; /* evicted or erased, awaiting reuse */
+  uint64_t memory_bytes_ = 0;
+  uint64_t hits_ = 0, misses_ = 0, evictions_ = 0, recycled_ = 0, allocated_ = 0;
+
+  std::unique_ptr<Texture420> texture_for( const unsigned int width, const unsigned int height );
+
+public:
+  explicit FrameCache( const uint64_t memory_budget = 512 << 20 );
+
+  /* the frame's textures, if resident (and now the most recently used); counts a hit or a miss */
+  Texture420* find( const uint64_t id );
+
+  /* Upload a frame (replacing any frame already held under `id`) and return its textures,
+     labelled with `colorimetry`. A view cropped from a larger raster is uploaded to the
+     textures' top-left corner; the textures are the size of the view. */
+  Texture420& insert( const uint64_t id, const ConstRaster420View& frame, const Colorimetry colorimetry = {} );
+  Texture420& insert( const uint64_t id, const Raster420& frame, const Colorimetry colorimetry = {} )
+  {
+    return insert( id, frame.view(), colorimetry );
+  }
+
+  /* find(), and on a miss insert() the frame produced by `source()` */
+  template<class Source>
+  Texture420& get( const uint64_t id, Source&& source, const Colorimetry colorimetry = {} )
+  {
+    Texture420* texture = find( id );
+    return texture ? *texture : insert( id, source(), colorimetry );
+  }
+
+  bool contains( const uint64_t id ) const { return index_.count( id ); }
+
+  /* drop a frame; its textures are kept for reuse */
+  void erase( const uint64_t id );
+
+  /* drop every frame and delete every texture */
+  void clear();
+
+  uint64_t memory_budget() const { return memory_budget_; }
+  Statistics statistics() const;
+  std::string summary_line() const;
+
+  /* forbid copy */
+  FrameCache( const FrameCache& other ) = delete;
+  FrameCache& operator=( const FrameCache& other ) = delete;
+};
@@ -0,0 +1,139 @@
+#include <cstring>
+
+#include "frame_capture.hh"
+#include "ycbcr.hh"
+
+using namespace std;
+
+FrameCapture::FrameCapture( const CaptureFormat format,
+                            Callback callback,
+                            const unsigned int ring_size,
+                            const size_t max_queued )
+  : format_( format )
+  , ring_( ring_size )
+  , buffer_memory_( MemoryKind::PixelBuffer, 0 )
+  , callback_( move( callback ) )
+  , max_queued_( max_queued )
+{
+  if ( ring_.empty() ) {
+    throw runtime_error( "FrameCapture needs at least one buffer" );
+  }
+}
+
+void FrameCapture::read( const unsigned int width, const unsigned int height, const uint64_t frame_number )
+{
+  Slot& slot = ring_.at( next_slot_ );
+  if ( slot.pending ) {
+    skipped_++;
+    return;
+  }
+
+  const size_t size = size_t( width ) * height * 4;
+
+  PixelPackBuffer::bind( slot.buffer );
+  if ( slot.capacity < size ) {
+    PixelPackBuffer::allocate( size, GL_STREAM_READ );
+    buffer_memory_.resize( buffer_memory_.bytes() - slot.capacity + size );
+    slot.capacity = size;
+  }
+
+  /* into the buffer, so glReadPixels returns as soon as the transfer is queued */
+  glPixelStorei( GL_PACK_ALIGNMENT, 1 );
+  glPixelStorei( GL_PACK_ROW_LENGTH, 0 );
+  glReadPixels( 0, 0, width, height, format_ == CaptureFormat::RGBA ? GL_RGBA : GL_BGRA, GL_UNSIGNED_BYTE, nullptr );
+  PixelPackBuffer::unbind();
+
+  slot.readback_complete.insert();
+  slot.pending = true;
+  slot.frame_number = frame_number;
+  slot.width = width;
+  slot.height = height;
+
+  next_slot_ = ( next_slot_ + 1 ) % ring_.size();
+
+  glCheck( "FrameCapture::read" );
+}
+
+void FrameCapture::poll()
+{
+  /* the slot about to be reused holds the oldest readback */
+  for ( unsigned int i = 0; i < ring_.size(); i++ ) {
+    Slot& slot = ring_.at( ( next_slot_ + i ) % ring_.size() );
+    if ( not slot.pending ) {
+      continue;
+    }
+
+    if ( not slot.readback_complete.signaled() ) {
+      return;
+    }
+
+    deliver( slot );
+  }
+}
+
+void FrameCapture::flush()
+{
+  for ( unsigned int i = 0; i < ring_.size(); i++ ) {
+    Slot& slot = ring_.at( ( next_slot_ + i ) % ring_.size() );
+    if ( slot.pending ) {
+      slot.readback_complete.wait();
+      deliver( slot );
+    }
+  }
+}
+
+void FrameCapture::deliver( Slot& slot )
+{
+  const size_t row_bytes = size_t( slot.width ) * 4;
+
+  PixelPackBuffer::bind( slot.buffer );
+  const uint8_t* pixels = PixelPackBuffer::map( row_bytes * slot.height, GL_MAP_READ_BIT );
+  if ( not pixels ) {
+    PixelPackBuffer::unbind();
+    glCheck( "mapping pixel-pack buffer" );
+    throw runtime_error( "could not map pixel-pack buffer" );
+  }
+
+  CapturedFrame frame { slot.frame_number, slot.width, slot.height };
+
+  /* GL returns the bottom row first */
+  if ( format_ == CaptureFormat::RGBA ) {
+    frame.rgba.resize( row_bytes * slot.height );
+    for ( unsigned int y = 0; y < slot.height; y++ ) {
+      memcpy( frame.rgba.data() + y * row_bytes, pixels + ( slot.height - 1 - y ) * row_bytes, row_bytes );
+    }
+  } else {
+    /* converted top row first, so chroma pairs rows the same way as in any other 4:2:0 frame */
+    frame.ycbcr.emplace( slot.width, slot.height, false );
+    bgra_to_ycbcr420( pixels + ( slot.height - 1 ) * row_bytes, -ptrdiff_t( row_bytes ), *frame.ycbcr );
+  }
+
+  PixelPackBuffer::unmap();
+  PixelPackBuffer::unbind();
+
+  slot.readback_complete.clear();
+  slot.pending = false;
+  delivered_++;
+
+  if ( callback_ ) {
+    callback_( move( frame ) );
+    return;
+  }
+
+  queue_.push_back( move( frame ) );
+  if ( queue_.size() > max_queued_ ) {
+    queue_.pop_front();
+    discarded_++;
+  }
+}
+
+optional<CapturedFrame> FrameCapture::pop()
+{
+  if ( queue_.empty() ) {
+    return {};
+  }
+
+  CapturedFrame frame = move( queue_.front() );
+  queue_.pop_front();
+  return frame;
+}
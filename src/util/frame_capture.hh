@@ -0,0 +1,86 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <optional>
+#include <vector>
+
+#include "gl_objects.hh"
+#include "raster.hh"
+
+enum class CaptureFormat
+{
+  RGBA,    /* 4 bytes per pixel */
+  YCbCr420 /* converted on the CPU, with the same matrix as bgra_to_ycbcr420() */
+};
+
+/* one rendered frame, top row first */
+struct CapturedFrame
+{
+  uint64_t frame_number;
+  unsigned int width, height;
+
+  std::vector<uint8_t> rgba {};      /* CaptureFormat::RGBA */
+  std::optional<Raster420> ycbcr {}; /* CaptureFormat::YCbCr420 */
+};
+
+/* Readback of rendered frames without stalling the GPU.
+
+   read() queues a transfer of the current read framebuffer into the next of a ring of
+   pixel-pack buffers and fences it; poll(), called once per frame, delivers every
+   transfer that has finished (to the callback if there is one, otherwise to a queue),
+   typically a frame or two later. If the GPU falls so far behind that the whole ring
+   is still in flight, the new frame is skipped rather than waited for. */
+class FrameCapture
+{
+public:
+  using Callback = std::function<void( CapturedFrame&& frame )>;
+
+private:
+  struct Slot
+  {
+    PixelBufferObject buffer {};
+    Fence readback_complete {};
+    size_t capacity = 0;
+    bool pending = false;
+    uint64_t frame_number = 0;
+    unsigned int width = 0, height = 0;
+  };
+
+  CaptureFormat format_;
+  std::vector<Slot> ring_;
+  MemoryAccount buffer_memory_;
+  unsigned int next_slot_ = 0;
+
+  Callback callback_;
+  std::deque<CapturedFrame> queue_ {};
+  size_t max_queued_;
+
+  uint64_t delivered_ = 0, skipped_ = 0, discarded_ = 0;
+
+  void deliver( Slot& slot );
+
+public:
+  /* without a callback, at most `max_queued` frames are kept for pop(); older ones are discarded */
+  FrameCapture( const CaptureFormat format,
+                Callback callback = {},
+                const unsigned int ring_size = 3,
+                const size_t max_queued = 8 );
+
+  /* queue a readback of the bound read framebuffer; call after drawing and before the swap */
+  void read( const unsigned int width, const unsigned int height, const uint64_t frame_number );
+
+  /* deliver the finished readbacks, oldest first, without waiting */
+  void poll();
+
+  /* wait for and deliver every readback in flight */
+  void flush();
+
+  std::optional<CapturedFrame> pop();
+  size_t queued() const { return queue_.size(); }
+
+  CaptureFormat format() const { return format_; }
+  uint64_t delivered() const { return delivered_; }
+  uint64_t skipped() const { return skipped_; }
+  uint64_t discarded() const { return discarded_; }
+};
@@ -0,0 +1,240 @@
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <unistd.h>
+#include <utility>
+
+#include "frame_recorder.hh"
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+
+/* O_DIRECT transfers must be whole blocks at block-aligned addresses and offsets */
+constexpr size_t DIRECT_IO_ALIGNMENT = 4096;
+
+size_t round_up( const size_t value, const size_t multiple )
+{
+  return ( value + multiple - 1 ) / multiple * multiple;
+}
+
+}
+
+void FrameRecorder::Deleter::operator()( uint8_t* x ) const
+{
+  free( x );
+}
+
+FrameRecorder::FrameRecorder( const string& filename,
+                              const unsigned int width,
+                              const unsigned int height,
+                              const Options& options )
+  : width_( width )
+  , height_( height )
+  , options_( options )
+  , record_bytes_( ( options.format == RecordingFormat::Y4M ? strlen( "FRAME\n" ) : 0 ) + size_t( width ) * height
+                   + 2 * size_t( width / 2 ) * ( height / 2 ) )
+  , fd_( -1 )
+  , direct_io_( options.direct_io )
+  , ring_()
+  , capacity_( round_up( max( size_t( options.buffered_frames ) * record_bytes_, 2 * options.chunk_size ),
+                         max<size_t>( options.chunk_size, 1 ) ) )
+  , memory_( MemoryKind::Raster, capacity_ )
+{
+  if ( options_.chunk_size == 0 or options_.chunk_size % DIRECT_IO_ALIGNMENT ) {
+    throw runtime_error( "FrameRecorder chunk size must be a multiple of " + to_string( DIRECT_IO_ALIGNMENT ) );
+  }
+
+  const int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+  if ( direct_io_ ) {
+    fd_ = open( filename.c_str(), flags | O_DIRECT, 0644 );
+
+    /* e.g. tmpfs; record through the page cache instead */
+    if ( fd_ < 0 and errno == EINVAL ) {
+      direct_io_ = false;
+    }
+  }
+
+  if ( fd_ < 0 ) {
+    fd_ = open( filename.c_str(), flags, 0644 );
+  }
+
+  if ( fd_ < 0 ) {
+    throw runtime_error( filename + ": " + strerror( errno ) );
+  }
+
+  ring_.reset( static_cast<uint8_t*>( aligned_alloc( DIRECT_IO_ALIGNMENT, capacity_ ) ) );
+  if ( not ring_ ) {
+    close( fd_ );
+    throw bad_alloc();
+  }
+
+  if ( options_.format == RecordingFormat::Y4M ) {
+    const string header = "YUV4MPEG2 W" + to_string( width_ ) + " H" + to_string( height_ ) + " F"
+                          + to_string( options_.frame_rate_numerator ) + ":"
+                          + to_string( options_.frame_rate_denominator ) + " Ip A1:1 C420jpeg\n";
+    uint64_t position = 0;
+    append( position, header.data(), header.size() );
+    appended_.store( position, memory_order_release );
+  }
+
+  writer_ = thread( &FrameRecorder::write_loop, this );
+}
+
+FrameRecorder::~FrameRecorder()
+{
+  try {
+    finish();
+  } catch ( const exception& e ) {
+    cerr << "FrameRecorder: " << e.what() << "\n";
+  }
+}
+
+void FrameRecorder::append( uint64_t& position, const void* data, const size_t length )
+{
+  const size_t offset = position % capacity_;
+  const size_t before_wrap = min( length, capacity_ - offset );
+
+  memcpy( ring_.get() + offset, data, before_wrap );
+  memcpy( ring_.get(), static_cast<const uint8_t*>( data ) + before_wrap, length - before_wrap );
+  position += length;
+}
+
+bool FrameRecorder::record( const ConstRaster420View& frame )
+{
+  if ( frame.Y.width() != width_ or frame.Y.height() != height_ ) {
+    throw runtime_error( "FrameRecorder: frame is " + to_string( frame.Y.width() ) + "x"
+                         + to_string( frame.Y.height() ) + ", expected " + to_string( width_ ) + "x"
+                         + to_string( height_ ) );
+  }
+
+  /* only this thread moves appended_ */
+  uint64_t position = appended_.load( memory_order_relaxed );
+  const uint64_t written = written_.load( memory_order_acquire );
+
+  if ( failed_ or finishing_ or capacity_ - ( position - written ) < record_bytes_ ) {
+    frames_dropped_++;
+    return false;
+  }
+
+  if ( options_.format == RecordingFormat::Y4M ) {
+    append( position, "FRAME\n", strlen( "FRAME\n" ) );
+  }
+
+  for ( const auto& plane : { frame.Y, frame.Cb, frame.Cr } ) {
+    for ( const auto row : plane.rows() ) {
+      append( position, row.begin(), row.size() );
+    }
+  }
+
+  appended_.store( position, memory_order_release );
+  frames_recorded_++;
+
+  const uint64_t fill = position - written;
+  if ( fill > peak_fill_.load( memory_order_relaxed ) ) {
+    peak_fill_.store( fill, memory_order_relaxed );
+  }
+
+  if ( fill >= options_.chunk_size ) {
+    wakeup_.notify_one();
+  }
+
+  return true;
+}
+
+void FrameRecorder::write_chunk( const uint64_t offset, const size_t length )
+{
+  const uint8_t* data = ring_.get() + offset % capacity_;
+
+  /* chunks start on chunk boundaries, so even a padded final chunk stays inside the ring */
+  const size_t transfer = direct_io_ ? round_up( length, DIRECT_IO_ALIGNMENT ) : length;
+
+  const auto start = steady_clock::now();
+
+  size_t done = 0;
+  while ( done < transfer ) {
+    const ssize_t result = pwrite( fd_, data + done, transfer - done, offset + done );
+    if ( result < 0 ) {
+      if ( errno == EINTR ) {
+        continue;
+      }
+      throw runtime_error( string( "FrameRecorder write: " ) + strerror( errno ) );
+    }
+    done += result;
+  }
+
+  if ( transfer != length and ftruncate( fd_, offset + length ) < 0 ) {
+    throw runtime_error( string( "FrameRecorder truncate: " ) + strerror( errno ) );
+  }
+
+  const uint64_t nanoseconds = duration_cast<std::chrono::nanoseconds>( steady_clock::now() - start ).count();
+  if ( nanoseconds > slowest_write_ns_.load( memory_order_relaxed ) ) {
+    slowest_write_ns_.store( nanoseconds, memory_order_relaxed );
+  }
+}
+
+void FrameRecorder::write_loop()
+{
+  try {
+    uint64_t written = 0;
+
+    while ( true ) {
+      /* read the flag first, so that everything appended before it was set is seen below */
+      const bool finishing = finishing_.load( memory_order_acquire );
+      const uint64_t appended = appended_.load( memory_order_acquire );
+
+      if ( appended - written >= options_.chunk_size ) {
+        write_chunk( written, options_.chunk_size );
+        written += options_.chunk_size;
+        written_.store( written, memory_order_release );
+        continue;
+      }
+
+      if ( finishing ) {
+        if ( appended > written ) {
+          write_chunk( written, appended - written );
+          written_.store( appended, memory_order_release );
+        }
+        return;
+      }
+
+      /* record() only signals once a whole chunk is waiting; the timeout covers a missed signal */
+      unique_lock<mutex> lock { wakeup_mutex_ };
+      wakeup_.wait_for( lock, milliseconds( 10 ) );
+    }
+  } catch ( ... ) {
+    error_ = current_exception();
+    failed_ = true;
+  }
+}
+
+void FrameRecorder::finish()
+{
+  if ( not writer_.joinable() ) {
+    return;
+  }
+
+  finishing_.store( true, memory_order_release );
+  wakeup_.notify_one();
+  writer_.join();
+
+  close( fd_ );
+  fd_ = -1;
+
+  if ( error_ ) {
+    rethrow_exception( exchange( error_, nullptr ) );
+  }
+}
+
+FrameRecorder::Statistics FrameRecorder::statistics() const
+{
+  return { frames_recorded_,
+           frames_dropped_,
+           written_.load( memory_order_acquire ),
+           double( peak_fill_ ) / capacity_,
+           slowest_write_ns_ / 1.0e6 };
+}
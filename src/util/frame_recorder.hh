@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "raster.hh"
+
+enum class RecordingFormat
+{
+  Y4M,    /* YUV4MPEG2, 4:2:0 with centred chroma (C420jpeg) */
+  RawI420 /* planes only, no headers */
+};
+
+/* Writes 4:2:0 frames to a file without holding up the thread that produces them.
+
+   record() copies the frame into a ring buffer and returns; a writer thread drains the
+   ring to disk in large chunks. With `direct_io`, the file is opened with O_DIRECT (where
+   the filesystem allows it) and every write is a whole number of aligned blocks, so the
+   recording bypasses the page cache. If the disk can't keep up and the ring fills,
+   frames are dropped, not waited for, and counted. */
+class FrameRecorder
+{
+public:
+  struct Options
+  {
+    RecordingFormat format = RecordingFormat::Y4M;
+    unsigned int frame_rate_numerator = 60, frame_rate_denominator = 1;
+    unsigned int buffered_frames = 16; /* ring capacity, in frames */
+    size_t chunk_size = 4 << 20;       /* bytes per write; a multiple of 4096 */
+    bool direct_io = false;
+  };
+
+  struct Statistics
+  {
+    uint64_t frames_recorded, frames_dropped, bytes_written;
+    double peak_fill; /* the fullest the ring has been, as a fraction */
+    double slowest_write_ms;
+  };
+
+private:
+  struct Deleter
+  {
+    void operator()( uint8_t* x ) const;
+  };
+
+  unsigned int width_, height_;
+  Options options_;
+  size_t record_bytes_;
+
+  int fd_;
+  bool direct_io_;
+
+  std::unique_ptr<uint8_t, Deleter> ring_;
+  size_t capacity_;
+  MemoryAccount memory_;
+
+  /* bytes appended by record() and bytes written by the writer, since the start */
+  alignas( 64 ) std::atomic<uint64_t> appended_ { 0 };
+  alignas( 64 ) std::atomic<uint64_t> written_ { 0 };
+
+  std::atomic<uint64_t> frames_recorded_ { 0 }, frames_dropped_ { 0 };
+  std::atomic<uint64_t> peak_fill_ { 0 }, slowest_write_ns_ { 0 };
+
+  std::atomic<bool> finishing_ { false }, failed_ { false };
+  std::exception_ptr error_ {};
+
+  std::mutex wakeup_mutex_ {};
+  std::condition_variable wakeup_ {};
+  std::thread writer_ {};
+
+  void append( uint64_t& position, const void* data, const size_t length );
+  void write_chunk( const uint64_t offset, const size_t length );
+  void write_loop();
+
+public:
+  FrameRecorder( const std::string& filename,
+                 const unsigned int width,
+                 const unsigned int height,
+                 const Options& options );
+
+  /* finishes the recording */
+  ~FrameRecorder();
+
+  /* queue a frame; false if it was dropped because the ring is full or the writer has failed */
+  bool record( const ConstRaster420View& frame );
+  bool record( const Raster420& frame ) { return record( frame.view() ); }
+
+  /* write everything queued and close the file; rethrows any error from the writer */
+  void finish();
+
+  bool direct_io() const { return direct_io_; }
+  Statistics statistics() const;
+
+  /* forbid copy */
+  FrameRecorder( const FrameRecorder& other ) = delete;
+  FrameRecorder& operator=( const FrameRecorder& other ) = delete;
+};
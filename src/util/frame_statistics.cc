@@ -0,0 +1,77 @@
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+#include "frame_statistics.hh"
+
+using namespace std;
+
+void FrameStatistics::record( const Metric metric, const double milliseconds )
+{
+  Series& s = series( metric );
+
+  if ( s.samples.size() < WINDOW ) {
+    s.samples.push_back( milliseconds );
+  } else {
+    s.samples.at( s.next ) = milliseconds;
+  }
+  s.next = ( s.next + 1 ) % WINDOW;
+
+  if ( metric == Metric::Interval ) {
+    frame_count_++;
+    interval_histogram_.at( min( HISTOGRAM_BUCKETS - 1, static_cast<unsigned int>( max( 0.0, milliseconds ) ) ) )++;
+
+    if ( deadline_ > 0 and milliseconds > 1.5 * deadline_ ) {
+      missed_deadlines_++;
+    }
+  }
+}
+
+FrameStatistics::Summary FrameStatistics::summary( const Metric metric ) const
+{
+  vector<double> sorted = series( metric ).samples;
+  if ( sorted.empty() ) {
+    return { 0, 0, 0, 0, 0 };
+  }
+
+  sort( sorted.begin(), sorted.end() );
+
+  const auto percentile = [&]( const double p ) {
+    return sorted.at( static_cast<size_t>( p * ( sorted.size() - 1 ) ) );
+  };
+
+  return {
+    static_cast<unsigned int>( sorted.size() ), percentile( 0.5 ), percentile( 0.95 ), percentile( 0.99 ), sorted.back()
+  };
+}
+
+string FrameStatistics::summary_line() const
+{
+  ostringstream out;
+  out << fixed << setprecision( 2 );
+
+  out << frame_count_ << " frames, " << missed_deadlines_ << " missed deadlines;";
+
+  for ( const auto& [metric, name] : { make_pair( Metric::Interval, "interval" ),
+                                       make_pair( Metric::Submit, "submit" ),
+                                       make_pair( Metric::Swap, "swap" ),
+                                       make_pair( Metric::GPU, "GPU" ) } ) {
+    const Summary s = summary( metric );
+    if ( s.count == 0 ) {
+      continue;
+    }
+
+    out << " " << name << " p50/p99/max " << s.p50 << "/" << s.p99 << "/" << s.max << " ms";
+  }
+
+  return out.str();
+}
+
+/* the deadline is configuration, not a statistic, and survives a reset */
+void FrameStatistics::reset()
+{
+  series_ = {};
+  interval_histogram_ = {};
+  frame_count_ = 0;
+  missed_deadlines_ = 0;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* Rolling record of per-frame timings, in milliseconds.
+
+   Percentiles cover the most recent WINDOW frames; the histogram of frame
+   intervals and the count of missed deadlines cover everything since reset(). */
+class FrameStatistics
+{
+public:
+  enum class Metric
+  {
+    Submit,  /* CPU time to issue the frame's GL commands */
+    Swap,    /* CPU time blocked in the buffer swap */
+    GPU,     /* GPU time to execute the frame (arrives a few frames late) */
+    Interval /* time between successive swaps */
+  };
+
+  struct Summary
+  {
+    unsigned int count;
+    double p50, p95, p99, max;
+  };
+
+  constexpr static unsigned int WINDOW = 1024;
+  constexpr static unsigned int HISTOGRAM_BUCKETS = 64; /* 1 ms each; the last also counts anything longer */
+
+private:
+  struct Series
+  {
+    std::vector<double> samples {};
+    unsigned int next = 0;
+  };
+
+  std::array<Series, 4> series_ {};
+  std::array<uint64_t, HISTOGRAM_BUCKETS> interval_histogram_ {};
+  double deadline_ = 1000.0 / 60.0;
+  uint64_t frame_count_ = 0;
+  uint64_t missed_deadlines_ = 0;
+
+  Series& series( const Metric metric ) { return series_.at( static_cast<unsigned int>( metric ) ); }
+  const Series& series( const Metric metric ) const { return series_.at( static_cast<unsigned int>( metric ) ); }
+
+public:
+  void record( const Metric metric, const double milliseconds );
+
+  Summary summary( const Metric metric ) const;
+  std::string summary_line() const;
+
+  /* a frame misses its deadline when it arrives more than half a period late,
+     i.e. at least one refresh went by without a new frame */
+  void set_deadline( const double milliseconds ) { deadline_ = milliseconds; }
+  double deadline() const { return deadline_; }
+
+  uint64_t frame_count() const { return frame_count_; }
+  uint64_t missed_deadlines() const { return missed_deadlines_; }
+  const std::array<uint64_t, HISTOGRAM_BUCKETS>& interval_histogram() const { return interval_histogram_; }
+
+  void reset();
+};
@@ -24,18 +24,59 @@
    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
 
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <memory>
 #include <stdexcept>
 
 #include "gl_objects.hh"
+#include "program_cache.hh"
 
 using namespace std;
 
-GLFWContext::GLFWContext()
+namespace {
+
+/* GLFW errors while trying one context API after another */
+string context_creation_errors;
+
+void record_context_creation_error( const int, const char* const description )
+{
+  context_creation_errors += "\n  ";
+  context_creation_errors += description;
+}
+
+/* how each sample type is stored and transferred */
+template<typename Sample>
+struct SampleFormat;
+
+template<>
+struct SampleFormat<uint8_t>
+{
+  static constexpr GLenum internal_format = GL_R8, type = GL_UNSIGNED_BYTE;
+};
+
+template<>
+struct SampleFormat<uint16_t>
+{
+  static constexpr GLenum internal_format = GL_R16, type = GL_UNSIGNED_SHORT;
+};
+
+}
+
+GLFWContext::GLFWContext( const bool headless )
 {
   glfwSetErrorCallback( error_callback );
 
+#ifdef GLFW_PLATFORM_NULL
+  if ( headless and not getenv( "DISPLAY" ) and not getenv( "WAYLAND_DISPLAY" ) ) {
+    glfwInitHint( GLFW_PLATFORM, GLFW_PLATFORM_NULL );
+  }
+#else
+  (void)headless;
+#endif
+
   glfwInit();
 }
 
@@ -49,7 +90,11 @@ GLFWContext::~GLFWContext()
   glfwTerminate();
 }
 
-Window::Window( const unsigned int width, const unsigned int height, const string& title, const bool fullscreen )
+Window::Window( const unsigned int width,
+                const unsigned int height,
+                const string& title,
+                const bool fullscreen,
+                const bool visible )
   : window_()
 {
   glfwDefaultWindowHints();
@@ -60,18 +105,64 @@ Window::Window( const unsigned int width, const unsigned int height, const strin
 
   glfwWindowHint( GLFW_RESIZABLE, GL_TRUE );
 
-  window_.reset(
-    glfwCreateWindow( width, height, title.c_str(), fullscreen ? glfwGetPrimaryMonitor() : nullptr, nullptr ) );
+  if ( visible ) {
+    window_.reset(
+      glfwCreateWindow( width, height, title.c_str(), fullscreen ? glfwGetPrimaryMonitor() : nullptr, nullptr ) );
+    if ( not window_.get() ) {
+      throw runtime_error( "could not create window" );
+    }
+    return;
+  }
+
+  glfwWindowHint( GLFW_VISIBLE, GLFW_FALSE );
+
+  /* a failed attempt is not an error while another API remains to be tried */
+  context_creation_errors.clear();
+  const GLFWerrorfun previous_callback = glfwSetErrorCallback( record_context_creation_error );
+
+  for ( const int api : { GLFW_NATIVE_CONTEXT_API, GLFW_EGL_CONTEXT_API, GLFW_OSMESA_CONTEXT_API } ) {
+    glfwWindowHint( GLFW_CONTEXT_CREATION_API, api );
+    window_.reset( glfwCreateWindow( width, height, title.c_str(), nullptr, nullptr ) );
+    if ( window_.get() ) {
+      break;
+    }
+  }
+
+  glfwSetErrorCallback( previous_callback );
+
   if ( not window_.get() ) {
-    throw runtime_error( "could not create window" );
+    throw runtime_error( "could not create offscreen context:" + context_creation_errors );
   }
 }
 
-void Window::make_context_current()
+Window::Window( const Window& share, const string& title )
+  : window_()
+{
+  glfwDefaultWindowHints();
+
+  glfwWindowHint( GLFW_CONTEXT_VERSION_MAJOR, 3 );
+  glfwWindowHint( GLFW_CONTEXT_VERSION_MINOR, 1 );
+  glfwWindowHint( GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE );
+  glfwWindowHint( GLFW_VISIBLE, GLFW_FALSE );
+
+  /* contexts can only share objects within one API */
+  glfwWindowHint( GLFW_CONTEXT_CREATION_API, glfwGetWindowAttrib( share.window_.get(), GLFW_CONTEXT_CREATION_API ) );
+
+  window_.reset( glfwCreateWindow( 1, 1, title.c_str(), nullptr, share.window_.get() ) );
+  if ( not window_.get() ) {
+    throw runtime_error( "could not create shared context" );
+  }
+}
+
+void Window::make_context_current( const bool load_functions )
 {
   glfwMakeContextCurrent( window_.get() );
   glCheck( "after MakeContextCurrent" );
 
+  if ( not load_functions ) {
+    return;
+  }
+
   glewExperimental = GL_TRUE;
   glewInit();
   glCheck( "after initializing GLEW", true );
@@ -117,7 +208,8 @@ void Window::Deleter::operator()( GLFWwindow* x ) const
   glfwDestroyWindow( x );
 }
 
-void Texture::bind( const GLenum texture_unit ) const
+template<typename Sample>
+void BasicTexture<Sample>::bind( const GLenum texture_unit ) const
 {
   glActiveTexture( texture_unit );
   glBindTexture( GL_TEXTURE_RECTANGLE, num_ );
@@ -127,21 +219,107 @@ void Texture::bind( const GLenum texture_unit ) const
   glTexParameteri( GL_TEXTURE_RECTANGLE, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
 }
 
-void Texture::load( const Plane& plane, const GLenum texture_unit )
+template<typename Sample>
+BasicTexture<Sample>::BasicTexture( const unsigned int width, const unsigned int height )
+  : num_()
+  , width_( width )
+  , height_( height )
+  , memory_( MemoryKind::Texture, uint64_t( width ) * height * sizeof( Sample ) )
 {
-  if ( plane.width() != width() or plane.height() != height() ) {
-    throw runtime_error( "plane's dimensions don't match texture's" );
+  glGenTextures( 1, &num_ );
+  glBindTexture( GL_TEXTURE_RECTANGLE, num_ );
+
+  /* one sample per texel; the shader reads the red channel */
+  if ( GLEW_ARB_texture_storage ) {
+    glTexStorage2D( GL_TEXTURE_RECTANGLE, 1, SampleFormat<Sample>::internal_format, width_, height_ );
+  } else {
+    glTexImage2D( GL_TEXTURE_RECTANGLE,
+                  0,
+                  SampleFormat<Sample>::internal_format,
+                  width_,
+                  height_,
+                  0,
+                  GL_RED,
+                  SampleFormat<Sample>::type,
+                  nullptr );
   }
+}
 
+template<typename Sample>
+void BasicTexture<Sample>::upload( const void* pixels,
+                                   const unsigned int row_length,
+                                   const unsigned int left,
+                                   const unsigned int top,
+                                   const unsigned int width,
+                                   const unsigned int height,
+                                   const GLenum texture_unit )
+{
   bind( texture_unit );
 
-  glPixelStorei( GL_UNPACK_ROW_LENGTH, width_ );
-  glTexImage2D( GL_TEXTURE_RECTANGLE, 0, GL_RGBA8, width_, height_, 0, GL_BGRA, GL_UNSIGNED_BYTE, nullptr );
+  glPixelStorei( GL_UNPACK_ROW_LENGTH, row_length );
+  glPixelStorei( GL_UNPACK_SKIP_PIXELS, left );
+  glPixelStorei( GL_UNPACK_SKIP_ROWS, top );
+  glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
   glTexSubImage2D(
-    GL_TEXTURE_RECTANGLE_ARB, 0, 0, 0, width_, height_, GL_LUMINANCE, GL_UNSIGNED_BYTE, &( plane.pixels().at( 0 ) ) );
+    GL_TEXTURE_RECTANGLE, 0, left, top, width, height, GL_RED, SampleFormat<Sample>::type, pixels );
+}
+
+template<typename Sample>
+void BasicTexture<Sample>::load( const BasicPlane<Sample>& plane, const GLenum texture_unit )
+{
+  if ( plane.width() != width() or plane.height() != height() ) {
+    throw runtime_error( "plane's dimensions don't match texture's" );
+  }
+
+  load( plane.view(), texture_unit );
+}
+
+template<typename Sample>
+void BasicTexture<Sample>::load( const BasicPlaneView<const Sample>& view, const GLenum texture_unit )
+{
+  if ( view.left() + view.width() > width() or view.top() + view.height() > height() ) {
+    throw runtime_error( "view extends outside texture" );
+  }
+
+  if ( view.width() == 0 or view.height() == 0 ) {
+    return;
+  }
+
+  /* back up to the top-left of the plane the view was cropped from, and let GL skip to it */
+  const Sample* plane_origin = view.pixels() - ( uint64_t( view.top() ) * view.stride() + view.left() );
+
+  upload( plane_origin, view.stride(), view.left(), view.top(), view.width(), view.height(), texture_unit );
+}
+
+template<typename Sample>
+void BasicTexture<Sample>::load_at_origin( const BasicPlaneView<const Sample>& view, const GLenum texture_unit )
+{
+  if ( view.width() > width() or view.height() > height() ) {
+    throw runtime_error( "view is larger than texture" );
+  }
+
+  if ( view.width() == 0 or view.height() == 0 ) {
+    return;
+  }
+
+  upload( view.pixels(), view.stride(), 0, 0, view.width(), view.height(), texture_unit );
 }
 
-Texture420::Texture420( const Raster420& sample )
+template<typename Sample>
+void BasicTexture<Sample>::load_from_buffer( const size_t offset, const GLenum texture_unit )
+{
+  upload( reinterpret_cast<const void*>( offset ), width_, 0, 0, width_, height_, texture_unit );
+}
+
+template<typename Sample>
+BasicTexture420<Sample>::BasicTexture420( const unsigned int width, const unsigned int height )
+  : Y( width, height )
+  , Cb( width / 2, height / 2 )
+  , Cr( width / 2, height / 2 )
+{}
+
+template<typename Sample>
+BasicTexture420<Sample>::BasicTexture420( const BasicRaster420<Sample>& sample )
   : Y( sample.Y.width(), sample.Y.height() )
   , Cb( sample.Cb.width(), sample.Cb.height() )
   , Cr( sample.Cr.width(), sample.Cr.height() )
@@ -151,67 +329,646 @@ Texture420::Texture420( const Raster420& sample )
   load( sample );
 }
 
-void Texture420::load( const Raster420& raster )
+template<typename Sample>
+void BasicTexture420<Sample>::load( const BasicRaster420<Sample>& raster )
 {
   Y.load( raster.Y, GL_TEXTURE0 );
   Cb.load( raster.Cb, GL_TEXTURE1 );
   Cr.load( raster.Cr, GL_TEXTURE2 );
+  bit_depth = raster.bit_depth;
+}
+
+template<typename Sample>
+void BasicTexture420<Sample>::load( const BasicRaster420View<const Sample>& view )
+{
+  Y.load( view.Y, GL_TEXTURE0 );
+  Cb.load( view.Cb, GL_TEXTURE1 );
+  Cr.load( view.Cr, GL_TEXTURE2 );
+}
+
+template<typename Sample>
+void BasicTexture420<Sample>::load_at_origin( const BasicRaster420View<const Sample>& view )
+{
+  Y.load_at_origin( view.Y, GL_TEXTURE0 );
+  Cb.load_at_origin( view.Cb, GL_TEXTURE1 );
+  Cr.load_at_origin( view.Cr, GL_TEXTURE2 );
 }
 
-void Texture420::bind() const
+template<typename Sample>
+void BasicTexture420<Sample>::bind() const
 {
   Y.bind( GL_TEXTURE0 );
   Cb.bind( GL_TEXTURE1 );
   Cr.bind( GL_TEXTURE2 );
 }
 
+template class BasicTexture<uint8_t>;
+template class BasicTexture<uint16_t>;
+template struct BasicTexture420<uint8_t>;
+template struct BasicTexture420<uint16_t>;
+
+TextureRG::TextureRG( const unsigned int width, const unsigned int height )
+  : num_()
+  , width_( width )
+  , height_( height )
+  , memory_( MemoryKind::Texture, uint64_t( width ) * height * 2 )
+{
+  glGenTextures( 1, &num_ );
+  glBindTexture( GL_TEXTURE_RECTANGLE, num_ );
+
+  if ( GLEW_ARB_texture_storage ) {
+    glTexStorage2D( GL_TEXTURE_RECTANGLE, 1, GL_RG8, width_, height_ );
+  } else {
+    glTexImage2D( GL_TEXTURE_RECTANGLE, 0, GL_RG8, width_, height_, 0, GL_RG, GL_UNSIGNED_BYTE, nullptr );
+  }
+}
+
+void TextureRG::bind( const GLenum texture_unit ) const
+{
+  glActiveTexture( texture_unit );
+  glBindTexture( GL_TEXTURE_RECTANGLE, num_ );
+  glTexParameteri( GL_TEXTURE_RECTANGLE, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+  glTexParameteri( GL_TEXTURE_RECTANGLE, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+  glTexParameteri( GL_TEXTURE_RECTANGLE, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+  glTexParameteri( GL_TEXTURE_RECTANGLE, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+}
+
+void TextureRG::load( const ConstPlaneView& pairs, const GLenum texture_unit )
+{
+  if ( ( pairs.left() | pairs.width() | pairs.stride() ) % 2 ) {
+    throw runtime_error( "TextureRG: view must hold whole pairs of samples" );
+  }
+
+  const unsigned int left = pairs.left() / 2, width = pairs.width() / 2;
+  if ( left + width > width_ or pairs.top() + pairs.height() > height_ ) {
+    throw runtime_error( "view extends outside texture" );
+  }
+
+  if ( width == 0 or pairs.height() == 0 ) {
+    return;
+  }
+
+  bind( texture_unit );
+
+  /* as for Texture, back up to the plane's origin; GL counts the row length and skip in texels */
+  const uint8_t* plane_origin = pairs.pixels() - ( uint64_t( pairs.top() ) * pairs.stride() + pairs.left() );
+
+  glPixelStorei( GL_UNPACK_ROW_LENGTH, pairs.stride() / 2 );
+  glPixelStorei( GL_UNPACK_SKIP_PIXELS, left );
+  glPixelStorei( GL_UNPACK_SKIP_ROWS, pairs.top() );
+  glPixelStorei( GL_UNPACK_ALIGNMENT, 2 );
+  glTexSubImage2D(
+    GL_TEXTURE_RECTANGLE, 0, left, pairs.top(), width, pairs.height(), GL_RG, GL_UNSIGNED_BYTE, plane_origin );
+}
+
+TextureNV12::TextureNV12( const unsigned int width, const unsigned int height )
+  : Y( width, height )
+  , CbCr( width / 2, height / 2 )
+{}
+
+TextureNV12::TextureNV12( const RasterNV12& sample )
+  : Y( sample.Y.width(), sample.Y.height() )
+  , CbCr( sample.CbCr.width() / 2, sample.CbCr.height() )
+{
+  load( sample );
+}
+
+void TextureNV12::load( const ConstRasterNV12View& view )
+{
+  Y.load( view.Y, GL_TEXTURE0 );
+  CbCr.load( view.CbCr, GL_TEXTURE1 );
+}
+
+void TextureNV12::bind() const
+{
+  Y.bind( GL_TEXTURE0 );
+  CbCr.bind( GL_TEXTURE1 );
+}
+
+TextureBGRA::TextureBGRA( const unsigned int width, const unsigned int height )
+  : num_()
+  , width_( width )
+  , height_( height )
+  , memory_( MemoryKind::Texture, uint64_t( width ) * height * 4 )
+{
+  glGenTextures( 1, &num_ );
+  glBindTexture( GL_TEXTURE_RECTANGLE, num_ );
+
+  if ( GLEW_ARB_texture_storage ) {
+    glTexStorage2D( GL_TEXTURE_RECTANGLE, 1, GL_RGBA8, width_, height_ );
+  } else {
+    glTexImage2D( GL_TEXTURE_RECTANGLE, 0, GL_RGBA8, width_, height_, 0, GL_BGRA, GL_UNSIGNED_BYTE, nullptr );
+  }
+}
+
+void TextureBGRA::bind( const GLenum texture_unit ) const
+{
+  glActiveTexture( texture_unit );
+  glBindTexture( GL_TEXTURE_RECTANGLE, num_ );
+  glTexParameteri( GL_TEXTURE_RECTANGLE, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+  glTexParameteri( GL_TEXTURE_RECTANGLE, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+  glTexParameteri( GL_TEXTURE_RECTANGLE, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+  glTexParameteri( GL_TEXTURE_RECTANGLE, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+}
+
+void TextureBGRA::load( const uint8_t* bgra,
+                        const unsigned int stride,
+                        const unsigned int x,
+                        const unsigned int y,
+                        const unsigned int width,
+                        const unsigned int height,
+                        const GLenum texture_unit )
+{
+  if ( x + width > width_ or y + height > height_ ) {
+    throw runtime_error( "rectangle extends outside texture" );
+  }
+
+  if ( stride % 4 ) {
+    throw runtime_error( "BGRA stride must be a whole number of pixels" );
+  }
+
+  if ( width == 0 or height == 0 ) {
+    return;
+  }
+
+  bind( texture_unit );
+
+  /* BGRA with 8_8_8_8_REV matches the GPU's native layout, so the driver copies without swizzling */
+  glPixelStorei( GL_UNPACK_ROW_LENGTH, stride / 4 );
+  glPixelStorei( GL_UNPACK_SKIP_PIXELS, x );
+  glPixelStorei( GL_UNPACK_SKIP_ROWS, y );
+  glPixelStorei( GL_UNPACK_ALIGNMENT, 4 );
+  glTexSubImage2D( GL_TEXTURE_RECTANGLE, 0, x, y, width, height, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, bgra );
+}
+
+static size_t align_to_cache_line( const size_t offset )
+{
+  return ( offset + 63 ) & ~size_t( 63 );
+}
+
+StreamingTexture420::StreamingTexture420( const unsigned int width,
+                                          const unsigned int height,
+                                          const unsigned int ring_size )
+  : texture_( width, height )
+  , Y_offset_( 0 )
+  , Cb_offset_( align_to_cache_line( size_t( width ) * height ) )
+  , Cr_offset_( Cb_offset_ + align_to_cache_line( size_t( width / 2 ) * ( height / 2 ) ) )
+  , frame_size_( Cr_offset_ + size_t( width / 2 ) * ( height / 2 ) )
+  , ring_( ring_size )
+  , buffer_memory_( MemoryKind::PixelBuffer, uint64_t( frame_size_ ) * ring_size )
+{
+  if ( ring_.empty() ) {
+    throw runtime_error( "StreamingTexture420 needs at least one buffer" );
+  }
+
+  for ( auto& slot : ring_ ) {
+    PixelUnpackBuffer::bind( slot.buffer );
+    PixelUnpackBuffer::allocate( frame_size_, GL_STREAM_DRAW );
+  }
+  PixelUnpackBuffer::unbind();
+
+  glCheck( "StreamingTexture420 constructor" );
+}
+
+Raster420View StreamingTexture420::map_next()
+{
+  if ( mapped_ ) {
+    throw runtime_error( "StreamingTexture420: previous buffer still mapped" );
+  }
+
+  Slot& slot = ring_.at( next_slot_ );
+
+  /* the driver may still be reading this buffer from its last trip around the ring */
+  slot.transfer_complete.wait();
+  slot.transfer_complete.clear();
+
+  /* no implicit synchronization needed, since the fence already did it */
+  PixelUnpackBuffer::bind( slot.buffer );
+  uint8_t* memory = PixelUnpackBuffer::map(
+    frame_size_, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT );
+  PixelUnpackBuffer::unbind();
+
+  if ( not memory ) {
+    glCheck( "mapping pixel-unpack buffer" );
+    throw runtime_error( "could not map pixel-unpack buffer" );
+  }
+
+  mapped_ = true;
+
+  return { { memory + Y_offset_, texture_.Y.width(), texture_.Y.height() },
+           { memory + Cb_offset_, texture_.Cb.width(), texture_.Cb.height() },
+           { memory + Cr_offset_, texture_.Cr.width(), texture_.Cr.height() } };
+}
+
+void StreamingTexture420::upload()
+{
+  if ( not mapped_ ) {
+    throw runtime_error( "StreamingTexture420: upload() without map_next()" );
+  }
+
+  Slot& slot = ring_.at( next_slot_ );
+
+  PixelUnpackBuffer::bind( slot.buffer );
+  PixelUnpackBuffer::unmap();
+  mapped_ = false;
+
+  texture_.Y.load_from_buffer( Y_offset_, GL_TEXTURE0 );
+  texture_.Cb.load_from_buffer( Cb_offset_, GL_TEXTURE1 );
+  texture_.Cr.load_from_buffer( Cr_offset_, GL_TEXTURE2 );
+  PixelUnpackBuffer::unbind();
+
+  slot.transfer_complete.insert();
+  next_slot_ = ( next_slot_ + 1 ) % ring_.size();
+
+  glCheck( "StreamingTexture420::upload" );
+}
+
+void StreamingTexture420::load( const Raster420& raster )
+{
+  if ( raster.Y.width() != texture_.Y.width() or raster.Y.height() != texture_.Y.height() ) {
+    throw runtime_error( "raster's dimensions don't match texture's" );
+  }
+
+  Raster420View frame = map_next();
+  for ( auto [source, destination] : { make_pair( &raster.Y, &frame.Y ),
+                                       make_pair( &raster.Cb, &frame.Cb ),
+                                       make_pair( &raster.Cr, &frame.Cr ) } ) {
+    for ( unsigned int y = 0; y < source->height(); y++ ) {
+      memcpy( destination->row( y ), source->row( y ), source->width() );
+    }
+  }
+  upload();
+}
+
+void Renderbuffer::allocate( const GLenum internal_format, const unsigned int width, const unsigned int height )
+{
+  glBindRenderbuffer( GL_RENDERBUFFER, num_ );
+  glRenderbufferStorage( GL_RENDERBUFFER, internal_format, width, height );
+  glCheck( "Renderbuffer::allocate" );
+}
+
+void Framebuffer::attach_color( const Renderbuffer& renderbuffer )
+{
+  glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffer.num_ );
+
+  const GLenum status = glCheckFramebufferStatus( GL_FRAMEBUFFER );
+  if ( status != GL_FRAMEBUFFER_COMPLETE ) {
+    throw runtime_error( "incomplete framebuffer (status " + to_string( status ) + ")" );
+  }
+}
+
+void Fence::insert()
+{
+  clear();
+
+  sync_ = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+  if ( not sync_ ) {
+    throw runtime_error( "glFenceSync failed" );
+  }
+}
+
+bool Fence::signaled() const
+{
+  if ( not sync_ ) {
+    return true;
+  }
+
+  const GLenum result = glClientWaitSync( sync_, GL_SYNC_FLUSH_COMMANDS_BIT, 0 );
+  if ( result == GL_WAIT_FAILED ) {
+    throw runtime_error( "glClientWaitSync failed" );
+  }
+
+  return result != GL_TIMEOUT_EXPIRED;
+}
+
+void Fence::wait() const
+{
+  if ( not sync_ ) {
+    return;
+  }
+
+  /* flush on the first try, so the fence is guaranteed to eventually signal */
+  GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+
+  while ( true ) {
+    const GLenum result = glClientWaitSync( sync_, flags, 1000000000 );
+
+    switch ( result ) {
+      case GL_ALREADY_SIGNALED:
+      case GL_CONDITION_SATISFIED:
+        return;
+      case GL_WAIT_FAILED:
+        throw runtime_error( "glClientWaitSync failed" );
+      default:
+        flags = 0;
+    }
+  }
+}
+
+void Fence::wait_on_gpu() const
+{
+  if ( sync_ ) {
+    glWaitSync( sync_, 0, GL_TIMEOUT_IGNORED );
+  }
+}
+
+void Fence::clear()
+{
+  if ( sync_ ) {
+    glDeleteSync( sync_ );
+    sync_ = nullptr;
+  }
+}
+
+void TimerQuery::end()
+{
+  glEndQuery( GL_TIME_ELAPSED );
+  pending_ = true;
+}
+
+bool TimerQuery::result_available() const
+{
+  if ( not pending_ ) {
+    return false;
+  }
+
+  GLint available = GL_FALSE;
+  glGetQueryObjectiv( num_, GL_QUERY_RESULT_AVAILABLE, &available );
+  return available == GL_TRUE;
+}
+
+uint64_t TimerQuery::nanoseconds()
+{
+  if ( not pending_ ) {
+    throw runtime_error( "TimerQuery::nanoseconds() called with no query outstanding" );
+  }
+
+  GLuint64 result = 0;
+  glGetQueryObjectui64v( num_, GL_QUERY_RESULT, &result );
+  pending_ = false;
+  return result;
+}
+
 void compile_shader( const GLuint num, const string& source )
 {
   const char* source_c_str = source.c_str();
   glShaderSource( num, 1, &source_c_str, nullptr );
   glCompileShader( num );
+}
 
-  /* check if there were log messages */
-  GLint log_length;
+namespace {
+
+string shader_log( const GLuint num )
+{
+  GLint log_length = 0;
   glGetShaderiv( num, GL_INFO_LOG_LENGTH, &log_length );
+  if ( log_length <= 1 ) {
+    return {};
+  }
+
+  unique_ptr<GLchar[]> buffer( new GLchar[log_length] );
+  GLsizei written_length = 0;
+  glGetShaderInfoLog( num, log_length, &written_length, buffer.get() );
+  return { buffer.get(), size_t( written_length ) };
+}
+
+string program_log( const GLuint num )
+{
+  GLint log_length = 0;
+  glGetProgramiv( num, GL_INFO_LOG_LENGTH, &log_length );
+  if ( log_length <= 1 ) {
+    return {};
+  }
+
+  unique_ptr<GLchar[]> buffer( new GLchar[log_length] );
+  GLsizei written_length = 0;
+  glGetProgramInfoLog( num, log_length, &written_length, buffer.get() );
+  return { buffer.get(), size_t( written_length ) };
+}
+
+const char* stage_name( const ShaderError::Stage stage )
+{
+  switch ( stage ) {
+    case ShaderError::Stage::Vertex:
+      return "vertex shader failed to compile";
+    case ShaderError::Stage::Fragment:
+      return "fragment shader failed to compile";
+    case ShaderError::Stage::Link:
+      return "shader program failed to link";
+  }
+  return "shader error";
+}
 
-  if ( log_length > 1 ) {
-    unique_ptr<GLchar> buffer( new GLchar[log_length] );
-    GLsizei written_length;
-    glGetShaderInfoLog( num, log_length, &written_length, buffer.get() );
+}
+
+ShaderError::ShaderError( const Stage stage, const string& log )
+  : runtime_error( string( stage_name( stage ) ) + ( log.empty() ? "" : ":\n" + log ) )
+  , stage_( stage )
+  , log_( log )
+{}
 
-    if ( written_length + 1 != log_length ) {
-      throw runtime_error( "GL shader log size mismatch" );
+vector<string> ShaderError::messages() const
+{
+  vector<string> result;
+  size_t start = 0;
+  while ( start < log_.size() ) {
+    size_t end = log_.find( '\n', start );
+    if ( end == string::npos ) {
+      end = log_.size();
     }
+    if ( log_.find_first_not_of( " \t\r", start ) < end ) {
+      result.push_back( log_.substr( start, end - start ) );
+    }
+    start = end + 1;
+  }
+  return result;
+}
 
-    cerr << "GL shader compilation log: " << string( buffer.get(), log_length ) << endl;
+Program::Program( const string& vertex_source, const string& fragment_source, ProgramCache& cache )
+{
+  cache.link( *this, vertex_source, fragment_source );
+}
+
+void Program::link()
+{
+  submit_link();
+  finish_link();
+}
+
+bool Program::link_complete() const
+{
+  if ( not GLEW_KHR_parallel_shader_compile and not GLEW_ARB_parallel_shader_compile ) {
+    return true; /* nothing to ask; finish_link() will wait */
   }
 
-  /* check if it compiled */
-  GLint success;
-  glGetShaderiv( num, GL_COMPILE_STATUS, &success );
+  GLint complete = GL_FALSE;
+  glGetProgramiv( num_, GL_COMPLETION_STATUS_KHR, &complete );
+  return complete == GL_TRUE;
+}
 
-  if ( not success ) {
-    throw runtime_error( "GL shader failed to compile" );
+void Program::finish_link()
+{
+  GLuint shaders[8];
+  GLsizei shader_count = 0;
+  glGetAttachedShaders( num_, 8, &shader_count, shaders );
+
+  if ( not linked() ) {
+    /* a shader that didn't compile is the more useful thing to report */
+    for ( GLsizei i = 0; i < shader_count; i++ ) {
+      GLint compiled = GL_FALSE, type = 0;
+      glGetShaderiv( shaders[i], GL_COMPILE_STATUS, &compiled );
+      glGetShaderiv( shaders[i], GL_SHADER_TYPE, &type );
+      if ( not compiled ) {
+        throw ShaderError( type == GL_VERTEX_SHADER ? ShaderError::Stage::Vertex : ShaderError::Stage::Fragment,
+                           shader_log( shaders[i] ) );
+      }
+    }
+
+    throw ShaderError( ShaderError::Stage::Link, program_log( num_ ) );
   }
+
+  /* warnings */
+  for ( GLsizei i = 0; i < shader_count; i++ ) {
+    const string log = shader_log( shaders[i] );
+    if ( not log.empty() ) {
+      cerr << "GL shader compilation log: " << log << endl;
+    }
+  }
+
+  reflect();
+}
+
+bool Program::linked() const
+{
+  GLint status = GL_FALSE;
+  glGetProgramiv( num_, GL_LINK_STATUS, &status );
+  return status == GL_TRUE;
 }
 
-GLint Program::attribute_location( const string& name ) const
+vector<uint8_t> Program::binary( GLenum& format ) const
 {
-  const GLint ret = glGetAttribLocation( num_, name.c_str() );
-  if ( ret < 0 ) {
+  GLint length = 0;
+  glGetProgramiv( num_, GL_PROGRAM_BINARY_LENGTH, &length );
+
+  vector<uint8_t> result( length );
+  if ( length > 0 ) {
+    GLsizei written = 0;
+    glGetProgramBinary( num_, length, &written, &format, result.data() );
+    result.resize( written );
+  }
+  return result;
+}
+
+bool Program::load_binary( const GLenum format, const vector<uint8_t>& binary )
+{
+  /* report anything already pending, so the only error discarded below is glProgramBinary's */
+  glCheck( "before loading a program binary" );
+
+  glProgramBinary( num_, format, binary.data(), binary.size() );
+
+  /* a rejected binary (an unknown format raises GL_INVALID_ENUM) isn't an error worth
+     reporting, just a reason to compile; the link status alone says if it was accepted */
+  glGetError();
+  if ( not linked() ) {
+    return false;
+  }
+
+  reflect();
+  return true;
+}
+
+void Program::reflect()
+{
+  uniforms_.clear();
+  attributes_.clear();
+  uniform_blocks_.clear();
+
+  GLint uniform_count = 0, attribute_count = 0, block_count = 0, max_name_length = 0, max_attribute_name_length = 0;
+  glGetProgramiv( num_, GL_ACTIVE_UNIFORMS, &uniform_count );
+  glGetProgramiv( num_, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_name_length );
+  glGetProgramiv( num_, GL_ACTIVE_ATTRIBUTES, &attribute_count );
+  glGetProgramiv( num_, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &max_attribute_name_length );
+  glGetProgramiv( num_, GL_ACTIVE_UNIFORM_BLOCKS, &block_count );
+
+  string name( max( max_name_length, max_attribute_name_length ) + 1, '\0' );
+
+  /* arrays are reported as "name[0]"; they're looked up as "name" */
+  const auto base_name = [&]( const GLsizei length ) {
+    string result = name.substr( 0, length );
+    if ( result.size() > 3 and result.compare( result.size() - 3, 3, "[0]" ) == 0 ) {
+      result.resize( result.size() - 3 );
+    }
+    return result;
+  };
+
+  for ( GLint i = 0; i < uniform_count; i++ ) {
+    GLsizei length = 0;
+    Variable variable { -1, 0, 0 };
+    glGetActiveUniform( num_, i, name.size(), &length, &variable.size, &variable.type, name.data() );
+    variable.location = glGetUniformLocation( num_, name.c_str() );
+
+    /* members of uniform blocks have no location of their own */
+    if ( variable.location >= 0 ) {
+      uniforms_.emplace( base_name( length ), variable );
+    }
+  }
+
+  for ( GLint i = 0; i < attribute_count; i++ ) {
+    GLsizei length = 0;
+    Variable variable { -1, 0, 0 };
+    glGetActiveAttrib( num_, i, name.size(), &length, &variable.size, &variable.type, name.data() );
+    variable.location = glGetAttribLocation( num_, name.c_str() );
+
+    /* built-ins (gl_VertexID and the like) have no location */
+    if ( variable.location >= 0 ) {
+      attributes_.emplace( base_name( length ), variable );
+    }
+  }
+
+  for ( GLint i = 0; i < block_count; i++ ) {
+    GLint name_length = 0, data_size = 0;
+    glGetActiveUniformBlockiv( num_, i, GL_UNIFORM_BLOCK_NAME_LENGTH, &name_length );
+    glGetActiveUniformBlockiv( num_, i, GL_UNIFORM_BLOCK_DATA_SIZE, &data_size );
+
+    string block_name( name_length, '\0' );
+    GLsizei length = 0;
+    glGetActiveUniformBlockName( num_, i, block_name.size(), &length, block_name.data() );
+    block_name.resize( length );
+
+    uniform_blocks_.emplace( block_name, UniformBlock { GLuint( i ), data_size } );
+  }
+}
+
+const Program::Variable& Program::attribute( const string& name ) const
+{
+  const auto found = attributes_.find( name );
+  if ( found == attributes_.end() ) {
     throw runtime_error( "attribute not found: " + name );
   }
-  return ret;
+  return found->second;
 }
 
-GLint Program::uniform_location( const string& name ) const
+const Program::Variable& Program::uniform( const string& name ) const
 {
-  const GLint ret = glGetUniformLocation( num_, name.c_str() );
-  if ( ret < 0 ) {
+  const auto found = uniforms_.find( name );
+  if ( found == uniforms_.end() ) {
     throw runtime_error( "uniform not found: " + name );
   }
-  return ret;
+  return found->second;
+}
+
+const Program::UniformBlock& Program::uniform_block( const string& name ) const
+{
+  const auto found = uniform_blocks_.find( name );
+  if ( found == uniform_blocks_.end() ) {
+    throw runtime_error( "uniform block not found: " + name );
+  }
+  return found->second;
+}
+
+void Program::bind_uniform_block( const string& name, const GLuint binding_point )
+{
+  glUniformBlockBinding( num_, uniform_block( name ).index, binding_point );
 }
 
 void glCheck( const string& where, bool ignore )
@@ -32,15 +32,24 @@
 #include <GLFW/glfw3.h>
 
 #include <memory>
+#include <optional>
+#include <stdexcept>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+#include "colorimetry.hh"
+#include "memory_usage.hh"
+#include "raster.hh"
+
 class GLFWContext
 {
   static void error_callback( const int, const char* const description );
 
 public:
-  GLFWContext();
+  /* with `headless` and no X11 or Wayland display to connect to, use GLFW's null platform
+     (GLFW 3.4 and later), which can still create EGL and OSMesa contexts */
+  GLFWContext( const bool headless = false );
   ~GLFWContext();
 
   /* forbid copy */
@@ -59,11 +68,19 @@ class Window
   std::unique_ptr<GLFWwindow, Deleter> window_;
 
 public:
+  /* an invisible window's context is tried through the native API, then EGL, then OSMesa */
   Window( const unsigned int width,
           const unsigned int height,
           const std::string& title,
-          const bool fullscreen = false );
-  void make_context_current();
+          const bool fullscreen = false,
+          const bool visible = true );
+
+  /* a hidden context that shares textures, buffers and sync objects with `share`'s, to be
+     made current on another thread; must be created on the thread that created `share` */
+  Window( const Window& share, const std::string& title );
+
+  /* `load_functions` is only needed for the first context made current in the process */
+  void make_context_current( const bool load_functions = true );
   bool should_close() const { return glfwWindowShouldClose( window_.get() ); }
   void swap_buffers() { glfwSwapBuffers( window_.get() ); }
   void set_swap_interval( const int interval ) { glfwSwapInterval( interval ); }
@@ -91,15 +108,29 @@ public:
     glBindBuffer( id_, obj.num_ );
   }
 
-  static void load( const std::vector<VertexObject>& vertices, const GLenum usage )
+  static void unbind() { glBindBuffer( id_, 0 ); }
+
+  template<class Vertex>
+  static void load( const std::vector<Vertex>& vertices, const GLenum usage )
+  {
+    glBufferData( id, vertices.size() * sizeof( Vertex ), &vertices.front(), usage );
+  }
+
+  static void allocate( const size_t size, const GLenum usage ) { glBufferData( id, size, nullptr, usage ); }
+
+  static uint8_t* map( const size_t size, const GLbitfield access )
   {
-    glBufferData( id, vertices.size() * sizeof( VertexObject ), &vertices.front(), usage );
+    return static_cast<uint8_t*>( glMapBufferRange( id, 0, size, access ) );
   }
 
+  static void unmap() { glUnmapBuffer( id ); }
+
   constexpr static GLenum id = id_;
 };
 
 using ArrayBuffer = Buffer<GL_ARRAY_BUFFER>;
+using PixelUnpackBuffer = Buffer<GL_PIXEL_UNPACK_BUFFER>;
+using PixelPackBuffer = Buffer<GL_PIXEL_PACK_BUFFER>;
 
 class VertexBufferObject
 {
@@ -120,6 +151,124 @@ public:
   VertexBufferObject& operator=( const VertexBufferObject& other ) = delete;
 };
 
+class PixelBufferObject
+{
+  friend PixelUnpackBuffer;
+  friend PixelPackBuffer;
+
+  GLuint num_;
+
+public:
+  PixelBufferObject()
+    : num_()
+  {
+    glGenBuffers( 1, &num_ );
+  }
+  ~PixelBufferObject() { glDeleteBuffers( 1, &num_ ); }
+
+  /* forbid copy */
+  PixelBufferObject( const PixelBufferObject& other ) = delete;
+  PixelBufferObject& operator=( const PixelBufferObject& other ) = delete;
+};
+
+class Renderbuffer
+{
+  friend class Framebuffer;
+
+  GLuint num_;
+
+public:
+  Renderbuffer()
+    : num_()
+  {
+    glGenRenderbuffers( 1, &num_ );
+  }
+  ~Renderbuffer() { glDeleteRenderbuffers( 1, &num_ ); }
+
+  void allocate( const GLenum internal_format, const unsigned int width, const unsigned int height );
+
+  /* forbid copy */
+  Renderbuffer( const Renderbuffer& other ) = delete;
+  Renderbuffer& operator=( const Renderbuffer& other ) = delete;
+};
+
+class Framebuffer
+{
+  GLuint num_;
+
+public:
+  Framebuffer()
+    : num_()
+  {
+    glGenFramebuffers( 1, &num_ );
+  }
+  ~Framebuffer() { glDeleteFramebuffers( 1, &num_ ); }
+
+  void bind() { glBindFramebuffer( GL_FRAMEBUFFER, num_ ); }
+  static void unbind() { glBindFramebuffer( GL_FRAMEBUFFER, 0 ); }
+
+  /* attach to the (bound) framebuffer and check that it is complete */
+  void attach_color( const Renderbuffer& renderbuffer );
+
+  /* forbid copy */
+  Framebuffer( const Framebuffer& other ) = delete;
+  Framebuffer& operator=( const Framebuffer& other ) = delete;
+};
+
+/* a point in the GL command stream that the CPU can wait for */
+class Fence
+{
+  GLsync sync_ = nullptr;
+
+public:
+  Fence() {}
+  ~Fence() { clear(); }
+
+  void insert();
+  bool signaled() const;
+  void wait() const;
+  void clear();
+
+  /* make the current context's later commands wait for the fence, without blocking the CPU
+     (the fence may have been inserted by another context, which must have flushed since) */
+  void wait_on_gpu() const;
+
+  bool pending() const { return sync_; }
+
+  /* forbid copy */
+  Fence( const Fence& other ) = delete;
+  Fence& operator=( const Fence& other ) = delete;
+};
+
+/* GPU time spent on the commands between begin() and end(); the result
+   arrives a few frames later and can be polled without stalling */
+class TimerQuery
+{
+  GLuint num_;
+  bool pending_ = false;
+
+public:
+  TimerQuery()
+    : num_()
+  {
+    glGenQueries( 1, &num_ );
+  }
+  ~TimerQuery() { glDeleteQueries( 1, &num_ ); }
+
+  void begin() { glBeginQuery( GL_TIME_ELAPSED, num_ ); }
+  void end();
+
+  bool pending() const { return pending_; }
+  bool result_available() const;
+
+  /* blocks if the result is not yet available */
+  uint64_t nanoseconds();
+
+  /* forbid copy */
+  TimerQuery( const TimerQuery& other ) = delete;
+  TimerQuery& operator=( const TimerQuery& other ) = delete;
+};
+
 class VertexArrayObject
 {
   GLuint num_;
@@ -139,87 +288,230 @@ public:
   VertexArrayObject& operator=( const VertexArrayObject& other ) = delete;
 };
 
-class Plane
+/* A single-channel rectangle texture of 8- or 16-bit samples (GL_R8 or GL_R16), which
+   the shader reads, normalized to 0..1, from the red channel. */
+template<typename Sample>
+class BasicTexture
 {
-  constexpr static uint8_t DEFAULT_PIXEL_VALUE = 128;
-
+  GLuint num_;
   unsigned int width_, height_;
-  std::vector<uint8_t> pixels_;
+  MemoryAccount memory_;
+
+  /* `pixels` is the top-left of a plane `row_length` samples wide, of which
+     the rectangle at (left, top) is transferred to the same place in the texture */
+  void upload( const void* pixels,
+               const unsigned int row_length,
+               const unsigned int left,
+               const unsigned int top,
+               const unsigned int width,
+               const unsigned int height,
+               const GLenum texture_unit );
 
 public:
-  Plane( const unsigned int width, const unsigned int height )
-    : width_( width )
-    , height_( height )
-    , pixels_( width * height, DEFAULT_PIXEL_VALUE )
-  {}
+  /* storage is allocated once, here, and reused by every load */
+  BasicTexture( const unsigned int width, const unsigned int height );
 
+  ~BasicTexture() { glDeleteTextures( 1, &num_ ); }
+
+  void bind( const GLenum texture_unit ) const;
+  void load( const BasicPlane<Sample>& raster, const GLenum texture_unit );
+
+  /* upload just the view's rectangle, to the same position in the texture */
+  void load( const BasicPlaneView<const Sample>& view, const GLenum texture_unit );
+
+  /* upload the view's rectangle to the texture's top-left corner, wherever it was cropped from */
+  void load_at_origin( const BasicPlaneView<const Sample>& view, const GLenum texture_unit );
+
+  /* load from the bound pixel-unpack buffer, starting `offset` bytes in */
+  void load_from_buffer( const size_t offset, const GLenum texture_unit );
   unsigned int width() const { return width_; }
   unsigned int height() const { return height_; }
-  const std::vector<uint8_t>& pixels() const { return pixels_; }
-  uint8_t* mutable_pixels() { return pixels_.data(); }
-  uint8_t& at( const unsigned int x, const unsigned int y )
-  {
-    if ( x >= width_ ) {
-      throw std::out_of_range( "x >= width" );
-    }
+  uint64_t memory_bytes() const { return memory_.bytes(); }
 
-    if ( y >= height_ ) {
-      throw std::out_of_range( "y >= height" );
-    }
+  /* disallow copy */
+  BasicTexture( const BasicTexture& other ) = delete;
+  BasicTexture& operator=( const BasicTexture& other ) = delete;
+};
 
-    return pixels_.at( y * width_ + x );
-  }
+using Texture = BasicTexture<uint8_t>;
+using Texture16 = BasicTexture<uint16_t>;
+
+template<typename Sample>
+struct BasicTexture420
+{
+  BasicTexture<Sample> Y, Cb, Cr;
+
+  /* how the samples convert to RGB; the display and compositor pick their shader by it */
+  Colorimetry colorimetry {};
+
+  /* significant bits per sample (see BasicRaster420); the display normalizes by it */
+  unsigned int bit_depth = 8 * sizeof( Sample );
+
+  BasicTexture420( const unsigned int width, const unsigned int height );
+  explicit BasicTexture420( const BasicRaster420<Sample>& sample );
+
+  /* a raster's bit depth comes along with it; a view's is left as it was */
+  void load( const BasicRaster420<Sample>& raster );
+  void load( const BasicRaster420View<const Sample>& view );
+  void load_at_origin( const BasicRaster420View<const Sample>& view );
+  void bind() const;
+
+  uint64_t memory_bytes() const { return Y.memory_bytes() + Cb.memory_bytes() + Cr.memory_bytes(); }
 };
 
-/* Raster of 4:2:0 8-bit Y'CbCr samples
-   ("4:2:0" means the dimension of Cb and Cr is 1/2 the width and 1/2 the height of Y') */
-struct Raster420
+using Texture420 = BasicTexture420<uint8_t>;
+using Texture420_16 = BasicTexture420<uint16_t>;
+
+/* Two 8-bit channels (GL_RG8), loaded from interleaved pairs of samples, such as the
+   chroma plane of an NV12 picture; the shader reads them from red and green. */
+class TextureRG
 {
-  Plane Y, Cb, Cr;
+  GLuint num_;
+  unsigned int width_, height_; /* in pairs */
+  MemoryAccount memory_;
 
 public:
-  Raster420( const unsigned int width, const unsigned int height )
-    : Y( width, height )
-    , Cb( width / 2, height / 2 )
-    , Cr( width / 2, height / 2 )
-  {}
+  TextureRG( const unsigned int width, const unsigned int height );
+  ~TextureRG() { glDeleteTextures( 1, &num_ ); }
+
+  void bind( const GLenum texture_unit ) const;
+
+  /* `pairs` is measured in samples, two per texel, so its position and width must be
+     even; it is uploaded to the same place in the texture */
+  void load( const ConstPlaneView& pairs, const GLenum texture_unit );
+
+  unsigned int width() const { return width_; }
+  unsigned int height() const { return height_; }
+  uint64_t memory_bytes() const { return memory_.bytes(); }
+
+  /* forbid copy */
+  TextureRG( const TextureRG& other ) = delete;
+  TextureRG& operator=( const TextureRG& other ) = delete;
 };
 
-class Texture
+/* An NV12 picture in two textures, uploaded in two transfers straight from the raster:
+   Y' (R8) on unit 0 and interleaved Cb/Cr (RG8) on unit 1. */
+struct TextureNV12
+{
+  Texture Y;
+  TextureRG CbCr;
+
+  Colorimetry colorimetry {};
+
+  TextureNV12( const unsigned int width, const unsigned int height );
+  explicit TextureNV12( const RasterNV12& sample );
+  void load( const RasterNV12& raster ) { load( raster.view() ); }
+  void load( const ConstRasterNV12View& view );
+  void bind() const;
+
+  uint64_t memory_bytes() const { return Y.memory_bytes() + CbCr.memory_bytes(); }
+};
+
+/* Four 8-bit channels, loaded from BGRA memory (e.g. a Cairo ARGB32 surface, whose alpha
+   is premultiplied) and sampled as RGBA. */
+class TextureBGRA
 {
   GLuint num_;
   unsigned int width_, height_;
+  MemoryAccount memory_;
 
 public:
-  Texture( const unsigned int width, const unsigned int height )
-    : num_()
-    , width_( width )
-    , height_( height )
+  TextureBGRA( const unsigned int width, const unsigned int height );
+  ~TextureBGRA() { glDeleteTextures( 1, &num_ ); }
+
+  void bind( const GLenum texture_unit ) const;
+
+  /* `bgra` is the top-left of an image the size of the texture, with rows `stride` bytes
+     apart; only the rectangle at (x, y) is transferred, to the same place in the texture */
+  void load( const uint8_t* bgra,
+             const unsigned int stride,
+             const unsigned int x,
+             const unsigned int y,
+             const unsigned int width,
+             const unsigned int height,
+             const GLenum texture_unit );
+  void load( const uint8_t* bgra, const unsigned int stride, const GLenum texture_unit )
   {
-    glGenTextures( 1, &num_ );
+    load( bgra, stride, 0, 0, width_, height_, texture_unit );
   }
 
-  ~Texture() { glDeleteTextures( 1, &num_ ); }
-
-  void bind( const GLenum texture_unit ) const;
-  void load( const Plane& raster, const GLenum texture_unit );
   unsigned int width() const { return width_; }
   unsigned int height() const { return height_; }
+  uint64_t memory_bytes() const { return memory_.bytes(); }
 
-  /* disallow copy */
-  Texture( const Texture& other ) = delete;
-  Texture& operator=( const Texture& other ) = delete;
+  /* forbid copy */
+  TextureBGRA( const TextureBGRA& other ) = delete;
+  TextureBGRA& operator=( const TextureBGRA& other ) = delete;
 };
 
-struct Texture420
+/* A Texture420 fed through a ring of pixel-unpack buffers.
+
+   The caller fills a mapped buffer (map_next()), then hands it to the driver (upload()),
+   which transfers it asynchronously; by the time the ring comes back around to that
+   buffer, a fence shows the transfer has finished. So the CPU can be writing frame N+1
+   while the driver is still copying frame N. */
+class StreamingTexture420
 {
-  Texture Y, Cb, Cr;
+  struct Slot
+  {
+    PixelBufferObject buffer {};
+    Fence transfer_complete {};
+  };
+
+  Texture420 texture_;
+  size_t Y_offset_, Cb_offset_, Cr_offset_, frame_size_;
+  std::vector<Slot> ring_;
+  MemoryAccount buffer_memory_;
+  unsigned int next_slot_ = 0;
+  bool mapped_ = false;
+
+public:
+  StreamingTexture420( const unsigned int width, const unsigned int height, const unsigned int ring_size = 3 );
+
+  /* wait until the next buffer in the ring is free, then map it for writing */
+  Raster420View map_next();
 
-  explicit Texture420( const Raster420& sample );
+  /* unmap the buffer and queue its transfer into the texture */
+  void upload();
+
+  /* copy a raster through the ring */
   void load( const Raster420& raster );
-  void bind() const;
+
+  Texture420& texture() { return texture_; }
+  const Texture420& texture() const { return texture_; }
+  unsigned int ring_size() const { return ring_.size(); }
+
+  /* texture storage plus the buffers in the ring */
+  uint64_t memory_bytes() const { return texture_.memory_bytes() + buffer_memory_.bytes(); }
+};
+
+/* A shader that failed to compile, or a program that failed to link, with the driver's log. */
+class ShaderError : public std::runtime_error
+{
+public:
+  enum class Stage
+  {
+    Vertex,
+    Fragment,
+    Link
+  };
+
+private:
+  Stage stage_;
+  std::string log_;
+
+public:
+  ShaderError( const Stage stage, const std::string& log );
+
+  Stage stage() const { return stage_; }
+  const std::string& log() const { return log_; }
+
+  /* the log's non-empty lines, which drivers usually write one diagnostic per */
+  std::vector<std::string> messages() const;
 };
 
+/* hands the source to the driver, which may compile it in the background;
+   the result is checked when a program using it finishes linking */
 void compile_shader( const GLuint num, const std::string& source );
 
 template<GLenum type_>
@@ -240,12 +532,54 @@ public:
   Shader& operator=( const Shader& other ) = delete;
 };
 
+template<class Block>
+class UniformBuffer;
+
+class ProgramCache;
+
 class Program
 {
+public:
+  /* an active uniform or attribute, as reported by the linker */
+  struct Variable
+  {
+    GLint location;
+    GLenum type;
+    GLint size; /* array length, or 1 */
+  };
+
+private:
+  struct UniformBlock
+  {
+    GLuint index;
+    GLint data_size;
+  };
+
   GLuint num_ = glCreateProgram();
 
+  /* filled in by link(), so lookups don't go to the driver */
+  std::unordered_map<std::string, Variable> uniforms_ {};
+  std::unordered_map<std::string, Variable> attributes_ {};
+  std::unordered_map<std::string, UniformBlock> uniform_blocks_ {};
+
+  void reflect();
+  const UniformBlock& uniform_block( const std::string& name ) const;
+  void bind_uniform_block( const std::string& name, const GLuint binding_point );
+
 public:
   Program() {}
+
+  /* attach both and link */
+  Program( const Shader<GL_VERTEX_SHADER>& vertex_shader, const Shader<GL_FRAGMENT_SHADER>& fragment_shader )
+  {
+    attach( vertex_shader );
+    attach( fragment_shader );
+    link();
+  }
+
+  /* link from the sources, or from the cache's binary of them (see ProgramCache) */
+  Program( const std::string& vertex_source, const std::string& fragment_source, ProgramCache& cache );
+
   ~Program() { glDeleteProgram( num_ ); }
 
   template<GLenum type_>
@@ -254,16 +588,195 @@ public:
     glAttachShader( num_, shader.num_ );
   }
 
-  void link() { glLinkProgram( num_ ); }
+  /* links, then records the active uniforms, attributes and uniform blocks;
+     throws ShaderError if a shader didn't compile or the program didn't link */
+  void link();
+
+  /* the same in two steps: submit_link() returns at once, and finish_link() waits if
+     needed; with KHR_parallel_shader_compile, link_complete() says when it won't */
+  void submit_link() { glLinkProgram( num_ ); }
+  bool link_complete() const;
+  void finish_link();
+
   void use() { glUseProgram( num_ ); }
+  bool linked() const;
+
+  /* program binaries (ARB_get_program_binary): ask, before linking, to be able to
+     retrieve one; then retrieve it, or link from one instead of from shaders */
+  void set_binary_retrievable() { glProgramParameteri( num_, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE ); }
+  std::vector<uint8_t> binary( GLenum& format ) const;
 
-  GLint attribute_location( const std::string& name ) const;
-  GLint uniform_location( const std::string& name ) const;
+  /* false if the driver doesn't accept it */
+  bool load_binary( const GLenum format, const std::vector<uint8_t>& binary );
+
+  /* these throw if the program has no such active variable */
+  const Variable& uniform( const std::string& name ) const;
+  const Variable& attribute( const std::string& name ) const;
+  GLint attribute_location( const std::string& name ) const { return attribute( name ).location; }
+  GLint uniform_location( const std::string& name ) const { return uniform( name ).location; }
+
+  bool has_uniform( const std::string& name ) const { return uniforms_.count( name ) > 0; }
+
+  /* feed the named uniform block from `buffer`, through `binding_point` */
+  template<class Block>
+  void bind_uniform_block( const std::string& name, const UniformBuffer<Block>& buffer, const GLuint binding_point )
+  {
+    if ( size_t( uniform_block( name ).data_size ) > sizeof( Block ) ) {
+      throw std::runtime_error( "uniform block " + name + " is larger than its C++ struct" );
+    }
+    bind_uniform_block( name, binding_point );
+    buffer.bind( binding_point );
+  }
 
   /* forbid copy */
   Program( const Program& other ) = delete;
   Program& operator=( const Program& other ) = delete;
 };
 
+/* C++ counterparts of the GLSL types used in uniforms */
+namespace glsl {
+
+struct vec2
+{
+  float x, y;
+  bool operator==( const vec2& other ) const { return x == other.x and y == other.y; }
+};
+
+struct uvec2
+{
+  GLuint x, y;
+  bool operator==( const uvec2& other ) const { return x == other.x and y == other.y; }
+};
+
+struct vec4
+{
+  float x, y, z, w;
+  bool operator==( const vec4& other ) const
+  {
+    return x == other.x and y == other.y and z == other.z and w == other.w;
+  }
+};
+
+}
+
+/* for each C++ type, which GLSL types it may set, and how */
+template<class T>
+struct UniformType;
+
+template<>
+struct UniformType<float>
+{
+  static bool accepts( const GLenum type ) { return type == GL_FLOAT; }
+  static void set( const GLint location, const float value ) { glUniform1f( location, value ); }
+};
+
+template<>
+struct UniformType<GLint>
+{
+  static bool accepts( const GLenum type )
+  {
+    return type == GL_INT or type == GL_BOOL or type == GL_SAMPLER_2D or type == GL_SAMPLER_2D_RECT;
+  }
+  static void set( const GLint location, const GLint value ) { glUniform1i( location, value ); }
+};
+
+template<>
+struct UniformType<GLuint>
+{
+  static bool accepts( const GLenum type ) { return type == GL_UNSIGNED_INT; }
+  static void set( const GLint location, const GLuint value ) { glUniform1ui( location, value ); }
+};
+
+template<>
+struct UniformType<bool>
+{
+  static bool accepts( const GLenum type ) { return type == GL_BOOL; }
+  static void set( const GLint location, const bool value ) { glUniform1i( location, value ); }
+};
+
+template<>
+struct UniformType<glsl::vec2>
+{
+  static bool accepts( const GLenum type ) { return type == GL_FLOAT_VEC2; }
+  static void set( const GLint location, const glsl::vec2& value ) { glUniform2f( location, value.x, value.y ); }
+};
+
+template<>
+struct UniformType<glsl::uvec2>
+{
+  static bool accepts( const GLenum type ) { return type == GL_UNSIGNED_INT_VEC2; }
+  static void set( const GLint location, const glsl::uvec2& value ) { glUniform2ui( location, value.x, value.y ); }
+};
+
+template<>
+struct UniformType<glsl::vec4>
+{
+  static bool accepts( const GLenum type ) { return type == GL_FLOAT_VEC4; }
+  static void set( const GLint location, const glsl::vec4& value )
+  {
+    glUniform4f( location, value.x, value.y, value.z, value.w );
+  }
+};
+
+/* A uniform whose location and type were checked once, when the handle was made.
+
+   set() needs the program to be in use, and skips the call entirely if the value hasn't
+   changed; so keep one handle per uniform, or the remembered value goes stale. */
+template<class T>
+class Uniform
+{
+  GLint location_;
+  std::optional<T> value_ {};
+
+public:
+  Uniform( const Program& program, const std::string& name )
+    : location_( program.uniform_location( name ) )
+  {
+    if ( not UniformType<T>::accepts( program.uniform( name ).type ) ) {
+      throw std::runtime_error( "uniform " + name + " doesn't have the type of its handle" );
+    }
+  }
+
+  void set( const T& value )
+  {
+    if ( value_ and *value_ == value ) {
+      return;
+    }
+    UniformType<T>::set( location_, value );
+    value_ = value;
+  }
+};
+
+/* A buffer holding a uniform block, so several uniforms change with one upload.
+   `Block` must match the block's std140 layout. */
+template<class Block>
+class UniformBuffer
+{
+  GLuint num_;
+
+public:
+  UniformBuffer()
+    : num_()
+  {
+    glGenBuffers( 1, &num_ );
+    glBindBuffer( GL_UNIFORM_BUFFER, num_ );
+    glBufferData( GL_UNIFORM_BUFFER, sizeof( Block ), nullptr, GL_DYNAMIC_DRAW );
+  }
+
+  ~UniformBuffer() { glDeleteBuffers( 1, &num_ ); }
+
+  void update( const Block& contents )
+  {
+    glBindBuffer( GL_UNIFORM_BUFFER, num_ );
+    glBufferSubData( GL_UNIFORM_BUFFER, 0, sizeof( Block ), &contents );
+  }
+
+  void bind( const GLuint binding_point ) const { glBindBufferBase( GL_UNIFORM_BUFFER, binding_point, num_ ); }
+
+  /* forbid copy */
+  UniformBuffer( const UniformBuffer& other ) = delete;
+  UniformBuffer& operator=( const UniformBuffer& other ) = delete;
+};
+
 using VertexShader = Shader<GL_VERTEX_SHADER>;
 using FragmentShader = Shader<GL_FRAGMENT_SHADER>;
@@ -0,0 +1,64 @@
+#include <array>
+#include <atomic>
+#include <iomanip>
+#include <sstream>
+
+#include "memory_usage.hh"
+
+using namespace std;
+
+namespace {
+
+struct Counter
+{
+  atomic<uint64_t> current { 0 };
+  atomic<uint64_t> peak { 0 };
+};
+
+array<Counter, MEMORY_KIND_COUNT> counters;
+
+Counter& counter( const MemoryKind kind )
+{
+  return counters.at( static_cast<unsigned int>( kind ) );
+}
+
+string megabytes( const uint64_t bytes )
+{
+  ostringstream out;
+  out << fixed << setprecision( 1 ) << bytes / 1048576.0 << " MiB";
+  return out.str();
+}
+
+}
+
+void charge_memory( const MemoryKind kind, const uint64_t bytes )
+{
+  Counter& c = counter( kind );
+  const uint64_t now = c.current += bytes;
+
+  uint64_t peak = c.peak;
+  while ( now > peak and not c.peak.compare_exchange_weak( peak, now ) ) {
+  }
+}
+
+void release_memory( const MemoryKind kind, const uint64_t bytes )
+{
+  counter( kind ).current -= bytes;
+}
+
+MemoryUsage memory_usage( const MemoryKind kind )
+{
+  const Counter& c = counter( kind );
+  return { c.current, c.peak };
+}
+
+string memory_usage_summary()
+{
+  const MemoryUsage rasters = memory_usage( MemoryKind::Raster );
+  const MemoryUsage textures = memory_usage( MemoryKind::Texture );
+  const MemoryUsage buffers = memory_usage( MemoryKind::PixelBuffer );
+
+  return "rasters " + megabytes( rasters.current ) + " (peak " + megabytes( rasters.peak ) + "), textures "
+         + megabytes( textures.current ) + " (peak " + megabytes( textures.peak ) + "), pixel buffers "
+         + megabytes( buffers.current ) + " (peak " + megabytes( buffers.peak ) + ")";
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/* Process-wide accounting of the bytes held by rasters (system memory)
+   and by textures and pixel buffers (GPU/driver memory). */
+
+enum class MemoryKind
+{
+  Raster,
+  Texture,
+  PixelBuffer
+};
+
+constexpr unsigned int MEMORY_KIND_COUNT = 3;
+
+struct MemoryUsage
+{
+  uint64_t current, peak;
+};
+
+MemoryUsage memory_usage( const MemoryKind kind );
+std::string memory_usage_summary();
+
+void charge_memory( const MemoryKind kind, const uint64_t bytes );
+void release_memory( const MemoryKind kind, const uint64_t bytes );
+
+/* bytes charged to one kind of memory for as long as the owning object lives */
+class MemoryAccount
+{
+  MemoryKind kind_;
+  uint64_t bytes_;
+
+public:
+  MemoryAccount( const MemoryKind kind, const uint64_t bytes )
+    : kind_( kind )
+    , bytes_( bytes )
+  {
+    charge_memory( kind_, bytes_ );
+  }
+
+  ~MemoryAccount() { release_memory( kind_, bytes_ ); }
+
+  /* a copy of the owner holds its own copy of the memory */
+  MemoryAccount( const MemoryAccount& other )
+    : MemoryAccount( other.kind_, other.bytes_ )
+  {}
+
+  MemoryAccount( MemoryAccount&& other )
+    : kind_( other.kind_ )
+    , bytes_( other.bytes_ )
+  {
+    other.bytes_ = 0;
+  }
+
+  MemoryAccount& operator=( const MemoryAccount& other )
+  {
+    release_memory( kind_, bytes_ );
+    kind_ = other.kind_;
+    bytes_ = other.bytes_;
+    charge_memory( kind_, bytes_ );
+    return *this;
+  }
+
+  MemoryAccount& operator=( MemoryAccount&& other )
+  {
+    if ( this != &other ) {
+      release_memory( kind_, bytes_ );
+      kind_ = other.kind_;
+      bytes_ = other.bytes_;
+      other.bytes_ = 0;
+    }
+    return *this;
+  }
+
+  void resize( const uint64_t bytes )
+  {
+    release_memory( kind_, bytes_ );
+    bytes_ = bytes;
+    charge_memory( kind_, bytes_ );
+  }
+
+  uint64_t bytes() const { return bytes_; }
+};
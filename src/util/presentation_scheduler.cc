@@ -0,0 +1,161 @@
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include "display.hh"
+#include "presentation_scheduler.hh"
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+
+double seconds_between( const PresentationScheduler::Clock::time_point start,
+                        const PresentationScheduler::Clock::time_point end )
+{
+  return duration<double>( end - start ).count();
+}
+
+double monitor_refresh_rate()
+{
+  GLFWmonitor* monitor = glfwGetPrimaryMonitor();
+  const GLFWvidmode* mode = monitor ? glfwGetVideoMode( monitor ) : nullptr;
+  return ( mode and mode->refreshRate > 0 ) ? mode->refreshRate : 60;
+}
+
+}
+
+PresentationScheduler::PresentationScheduler( VideoDisplay& display,
+                                              DropCallback on_drop,
+                                              const double nominal_refresh_rate,
+                                              const size_t capacity )
+  : display_( display )
+  , on_drop_( move( on_drop ) )
+  , capacity_( capacity )
+  , period_( 1.0 / ( nominal_refresh_rate > 0 ? nominal_refresh_rate : monitor_refresh_rate() ) )
+  , vblank_( Clock::now() )
+  , submit_margin_( period_ / 4 )
+{
+  if ( capacity_ == 0 ) {
+    throw runtime_error( "PresentationScheduler needs room for at least one frame" );
+  }
+}
+
+bool PresentationScheduler::push( const Frame& frame )
+{
+  if ( not queue_.empty() and frame.due < queue_.back().due ) {
+    throw runtime_error( "PresentationScheduler: frames must be queued in order of presentation time" );
+  }
+
+  if ( full() ) {
+    return false;
+  }
+
+  queue_.push_back( frame );
+  return true;
+}
+
+/* Fold the display's latest swap into the estimate. A swap that returns well before the
+   predicted vblank didn't wait for it (no swap interval, or a driver that queues the
+   frame) and says nothing about the phase; one at or after it pulls the phase a quarter
+   of the way, and one within a sixteenth of a period refines the period too. */
+void PresentationScheduler::observe_swap()
+{
+  const Clock::time_point swap = display_.last_swap();
+  if ( swap == last_swap_ or swap == Clock::time_point {} ) {
+    return;
+  }
+
+  if ( last_swap_ == Clock::time_point {} ) {
+    vblank_ = last_swap_ = swap;
+    return;
+  }
+
+  const double tolerance = period_ / 16;
+  const long long vblanks = llround( seconds_between( vblank_, swap ) / period_ );
+  const double error = seconds_between( vblank_, swap ) - vblanks * period_;
+
+  if ( vblanks >= 1 and error >= -tolerance ) {
+    if ( error <= tolerance ) {
+      const double interval = seconds_between( last_swap_, swap );
+      const long long intervals = llround( interval / period_ );
+      if ( intervals >= 1 and intervals <= 4 and fabs( interval - intervals * period_ ) <= tolerance ) {
+        period_ += ( interval / intervals - period_ ) / 16;
+        display_.statistics().set_deadline( period_ * 1000 );
+      }
+    }
+
+    vblank_ += duration_cast<Clock::duration>( duration<double>( vblanks * period_ + error / 4 ) );
+  }
+
+  last_swap_ = swap;
+}
+
+/* the first vblank there is still time to draw for */
+PresentationScheduler::Clock::time_point PresentationScheduler::upcoming_vblank() const
+{
+  const double ahead = seconds_between( vblank_, Clock::now() ) + submit_margin_;
+  const long long vblanks = max( 1LL, static_cast<long long>( ceil( ahead / period_ ) ) );
+  return vblank_ + duration_cast<Clock::duration>( duration<double>( vblanks * period_ ) );
+}
+
+PresentationScheduler::Clock::time_point PresentationScheduler::vblank_nearest( const Clock::time_point time ) const
+{
+  const long long vblanks = llround( seconds_between( vblank_, time ) / period_ );
+  return vblank_ + duration_cast<Clock::duration>( duration<double>( vblanks * period_ ) );
+}
+
+optional<PresentationScheduler::Frame> PresentationScheduler::next()
+{
+  observe_swap();
+
+  const Clock::time_point vblank = upcoming_vblank();
+
+  /* nearest-vblank times are rounded to the clock, so compare with half a period of slack */
+  const auto shown_by = [&]( const Frame& frame ) {
+    return seconds_between( vblank_nearest( frame.due ), vblank ) > -period_ / 2;
+  };
+
+  /* a frame whose successor is also due by this vblank would never be seen */
+  while ( queue_.size() >= 2 and shown_by( queue_.at( 1 ) ) ) {
+    const Frame superseded = queue_.front();
+    queue_.pop_front();
+    dropped_++;
+    if ( on_drop_ ) {
+      on_drop_( superseded );
+    }
+  }
+
+  optional<Frame> frame;
+  if ( not queue_.empty() and shown_by( queue_.front() ) ) {
+    frame = queue_.front();
+    queue_.pop_front();
+    presented_++;
+    if ( seconds_between( vblank_nearest( frame->due ), vblank ) > period_ / 2 ) {
+      late_++;
+    }
+    shown_any_ = true;
+  } else if ( shown_any_ ) {
+    repeated_++;
+  }
+
+  this_thread::sleep_until( vblank - duration_cast<Clock::duration>( duration<double>( submit_margin_ ) ) );
+
+  return frame;
+}
+
+PresentationScheduler::Statistics PresentationScheduler::statistics() const
+{
+  return { presented_, late_, dropped_, repeated_, period_ * 1000 };
+}
+
+string PresentationScheduler::summary_line() const
+{
+  ostringstream out;
+  out << fixed << setprecision( 3 ) << "presentation: " << presented_ << " frames shown (" << late_ << " late), "
+      << dropped_ << " dropped, " << repeated_ << " refreshes repeated; refresh period " << period_ * 1000
+      << " ms (" << setprecision( 2 ) << 1 / period_ << " Hz)";
+  return out.str();
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <optional>
+#include <string>
+
+class VideoDisplay;
+
+/* Paces a VideoDisplay by the presentation times of the frames queued on it.
+
+   The scheduler estimates the display's refresh period and vblank phase from the times
+   its buffer swaps complete, starting from the monitor's nominal rate. Each frame is
+   shown on the vblank nearest its presentation time: next() sleeps until just before the
+   coming vblank and returns the frame that belongs there, or nothing if the picture on
+   screen should stay. A frame that a later one supersedes by then is dropped, not shown
+   late, so a player that falls behind catches up instead of drifting. Pacing comes from
+   sleeping, so it works the same with or without a swap interval.
+
+   Only used on the thread that draws. */
+class PresentationScheduler
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  struct Frame
+  {
+    Clock::time_point due;
+    uint64_t id; /* the caller's; the scheduler only passes it back */
+  };
+
+  using DropCallback = std::function<void( const Frame& frame )>;
+
+  struct Statistics
+  {
+    uint64_t presented, late, dropped, repeated;
+    double refresh_period_ms;
+  };
+
+private:
+  VideoDisplay& display_;
+  DropCallback on_drop_;
+  size_t capacity_;
+
+  std::deque<Frame> queue_ {}; /* in order of presentation time */
+
+  /* the estimate: a vblank at `vblank_`, and every `period_` either side of it */
+  double period_;                     /* seconds */
+  Clock::time_point vblank_ {};       /* the most recent swap completion, phase-locked */
+  Clock::time_point last_swap_ {};    /* as last seen from the display */
+  double submit_margin_;              /* how long before a vblank to wake and draw, in seconds */
+  bool shown_any_ = false;
+
+  uint64_t presented_ = 0, late_ = 0, dropped_ = 0, repeated_ = 0;
+
+  void observe_swap();
+  Clock::time_point upcoming_vblank() const;
+  Clock::time_point vblank_nearest( const Clock::time_point time ) const;
+
+public:
+  /* a `nominal_refresh_rate` of 0 takes the primary monitor's (or 60 Hz without one) */
+  explicit PresentationScheduler( VideoDisplay& display,
+                                  DropCallback on_drop = {},
+                                  const double nominal_refresh_rate = 0,
+                                  const size_t capacity = 8 );
+
+  /* queue a frame, no earlier than the last one queued; false (and not queued) if the queue is full */
+  bool push( const Frame& frame );
+
+  size_t queued() const { return queue_.size(); }
+  bool full() const { return queue_.size() >= capacity_; }
+
+  /* Sleep until it is time to draw for the coming vblank, dropping any frames superseded by
+     then, and return the frame to draw (nothing: keep showing the current picture). Draw
+     through the display before calling again, so its swap can be timed. */
+  std::optional<Frame> next();
+
+  /* the current estimates */
+  std::chrono::duration<double> refresh_period() const { return std::chrono::duration<double>( period_ ); }
+  Clock::time_point next_vblank() const { return upcoming_vblank(); }
+
+  /* wake this long before each vblank (default: a quarter period) */
+  void set_submit_margin( const std::chrono::duration<double> margin ) { submit_margin_ = margin.count(); }
+
+  Statistics statistics() const;
+  std::string summary_line() const;
+
+  /* forbid copy */
+  PresentationScheduler( const PresentationScheduler& other ) = delete;
+  PresentationScheduler& operator=( const PresentationScheduler& other ) = delete;
+};
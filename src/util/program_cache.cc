@@ -0,0 +1,236 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "gl_objects.hh"
+#include "program_cache.hh"
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+
+constexpr char MAGIC[8] = { 'G', 'L', 'D', 'P', 'R', 'O', 'G', '1' };
+
+struct FileHeader
+{
+  char magic[8];
+  uint32_t format;
+  uint32_t length;
+};
+
+/* FNV-1a, 64 bits */
+uint64_t hash_bytes( const string& data, uint64_t hash = 14695981039346656037ull )
+{
+  for ( const unsigned char c : data ) {
+    hash = ( hash ^ c ) * 1099511628211ull;
+  }
+  return hash;
+}
+
+string gl_string( const GLenum name )
+{
+  const GLubyte* value = glGetString( name );
+  return value ? reinterpret_cast<const char*>( value ) : "";
+}
+
+uint64_t cache_key( const string& vertex_source, const string& fragment_source )
+{
+  uint64_t key = hash_bytes( vertex_source );
+  key = hash_bytes( string( 1, '\0' ) + fragment_source, key );
+  for ( const GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION } ) {
+    key = hash_bytes( string( 1, '\0' ) + gl_string( name ), key );
+  }
+  return key;
+}
+
+/* mkdir -p, quietly; true if the directory exists afterwards */
+bool make_directories( const string& path )
+{
+  for ( size_t slash = path.find( '/', 1 ); slash != string::npos; slash = path.find( '/', slash + 1 ) ) {
+    mkdir( path.substr( 0, slash ).c_str(), 0755 );
+  }
+  mkdir( path.c_str(), 0755 );
+
+  struct stat info;
+  return stat( path.c_str(), &info ) == 0 and S_ISDIR( info.st_mode );
+}
+
+string default_directory()
+{
+  if ( const char* explicit_directory = getenv( "GLDEMO_SHADER_CACHE" ) ) {
+    return explicit_directory;
+  }
+  if ( const char* xdg_cache = getenv( "XDG_CACHE_HOME" ); xdg_cache and *xdg_cache ) {
+    return string( xdg_cache ) + "/gldemo-shaders";
+  }
+  if ( const char* home = getenv( "HOME" ); home and *home ) {
+    return string( home ) + "/.cache/gldemo-shaders";
+  }
+  return {};
+}
+
+double milliseconds_since( const steady_clock::time_point start )
+{
+  return duration<double, milli>( steady_clock::now() - start ).count();
+}
+
+}
+
+ProgramCache::ProgramCache( const string& directory )
+  : directory_( directory.empty() or make_directories( directory ) ? directory : string() )
+{}
+
+ProgramCache& ProgramCache::shared()
+{
+  static ProgramCache cache { default_directory() };
+  return cache;
+}
+
+string ProgramCache::filename( const string& vertex_source, const string& fragment_source ) const
+{
+  ostringstream name;
+  name << directory_ << "/" << hex << setw( 16 ) << setfill( '0' ) << cache_key( vertex_source, fragment_source )
+       << ".bin";
+  return name.str();
+}
+
+bool ProgramCache::stores_binaries() const
+{
+  return enabled() and GLEW_ARB_get_program_binary;
+}
+
+void ProgramCache::link( Program& program, const string& vertex_source, const string& fragment_source )
+{
+  const auto start = steady_clock::now();
+
+  if ( load( program, vertex_source, fragment_source ) ) {
+    return;
+  }
+
+  VertexShader vertex_shader { vertex_source };
+  FragmentShader fragment_shader { fragment_source };
+  program.attach( vertex_shader );
+  program.attach( fragment_shader );
+  if ( stores_binaries() ) {
+    program.set_binary_retrievable();
+  }
+  program.link();
+
+  save( program, vertex_source, fragment_source, milliseconds_since( start ) );
+}
+
+bool ProgramCache::load( Program& program, const string& vertex_source, const string& fragment_source )
+{
+  if ( not stores_binaries() ) {
+    return false;
+  }
+
+  const auto start = steady_clock::now();
+  if ( not read_binary( program, filename( vertex_source, fragment_source ) ) ) {
+    return false;
+  }
+
+  statistics_.hits++;
+  statistics_.hit_ms += milliseconds_since( start );
+  return true;
+}
+
+void ProgramCache::save( const Program& program,
+                         const string& vertex_source,
+                         const string& fragment_source,
+                         const double build_ms )
+{
+  statistics_.misses++;
+  statistics_.miss_ms += build_ms;
+
+  if ( stores_binaries() ) {
+    write_binary( program, filename( vertex_source, fragment_source ) );
+  }
+}
+
+bool ProgramCache::read_binary( Program& program, const string& filename )
+{
+  ifstream file { filename, ios::binary };
+  if ( not file ) {
+    return false;
+  }
+
+  FileHeader header;
+  if ( not file.read( reinterpret_cast<char*>( &header ), sizeof( header ) )
+       or memcmp( header.magic, MAGIC, sizeof( MAGIC ) ) != 0 ) {
+    statistics_.rejected++;
+    return false;
+  }
+
+  vector<uint8_t> binary( header.length );
+  if ( not file.read( reinterpret_cast<char*>( binary.data() ), binary.size() ) ) {
+    statistics_.rejected++;
+    return false;
+  }
+
+  /* the driver may still refuse it, e.g. after an update that kept the version string */
+  if ( not program.load_binary( header.format, binary ) ) {
+    statistics_.rejected++;
+    return false;
+  }
+
+  return true;
+}
+
+/* written to a temporary file and renamed, so a concurrent reader never sees half an entry */
+void ProgramCache::write_binary( const Program& program, const string& filename )
+{
+  GLenum format = 0;
+  const vector<uint8_t> binary = program.binary( format );
+  if ( binary.empty() ) {
+    return;
+  }
+
+  FileHeader header {};
+  memcpy( header.magic, MAGIC, sizeof( MAGIC ) );
+  header.format = format;
+  header.length = binary.size();
+
+  const string temporary = filename + "." + to_string( getpid() ) + ".tmp";
+  {
+    ofstream file { temporary, ios::binary | ios::trunc };
+    file.write( reinterpret_cast<const char*>( &header ), sizeof( header ) );
+    file.write( reinterpret_cast<const char*>( binary.data() ), binary.size() );
+    if ( not file ) {
+      unlink( temporary.c_str() );
+      return;
+    }
+  }
+
+  if ( rename( temporary.c_str(), filename.c_str() ) != 0 ) {
+    unlink( temporary.c_str() );
+  }
+}
+
+string ProgramCache::summary_line() const
+{
+  ostringstream out;
+  out << fixed << setprecision( 2 ) << "shader programs: " << statistics_.hits << " from cache";
+  if ( statistics_.hits ) {
+    out << " (" << statistics_.hit_ms / statistics_.hits << " ms each)";
+  }
+  out << ", " << statistics_.misses << " compiled";
+  if ( statistics_.misses ) {
+    out << " (" << statistics_.miss_ms / statistics_.misses << " ms each)";
+  }
+  if ( statistics_.rejected ) {
+    out << ", " << statistics_.rejected << " cached binaries rejected";
+  }
+  if ( not enabled() ) {
+    out << " [cache disabled]";
+  }
+  return out.str();
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+class Program;
+
+/* Linked shader programs, saved to disk with glGetProgramBinary so later runs skip the compiler.
+
+   An entry is keyed by a hash of the shader sources and of the GL vendor, renderer and
+   version strings, so a driver update never loads a stale binary. If the driver rejects a
+   cached binary anyway (or the extension is missing, or the directory is unusable), the
+   program is compiled and linked from source as usual, and the cache entry rewritten.
+   Use from the thread that owns the GL context. */
+class ProgramCache
+{
+public:
+  struct Statistics
+  {
+    uint64_t hits, misses, rejected;
+    double hit_ms, miss_ms; /* total time to produce a linked program, either way */
+  };
+
+private:
+  std::string directory_;
+  Statistics statistics_ { 0, 0, 0, 0, 0 };
+
+  std::string filename( const std::string& vertex_source, const std::string& fragment_source ) const;
+  bool read_binary( Program& program, const std::string& filename );
+  void write_binary( const Program& program, const std::string& filename );
+
+public:
+  /* an empty directory disables the cache */
+  explicit ProgramCache( const std::string& directory );
+
+  /* link `program` from the sources, or from a cached binary of them */
+  void link( Program& program, const std::string& vertex_source, const std::string& fragment_source );
+
+  /* The same in two steps, for callers that compile in the background (see ShaderBuilder):
+     load() links from the cache if it can; if not, the caller links from source and
+     then calls save() with how long that took. */
+  bool load( Program& program, const std::string& vertex_source, const std::string& fragment_source );
+  void save( const Program& program,
+             const std::string& vertex_source,
+             const std::string& fragment_source,
+             const double build_ms );
+
+  /* whether programs should be linked with set_binary_retrievable() */
+  bool stores_binaries() const;
+
+  bool enabled() const { return not directory_.empty(); }
+  const std::string& directory() const { return directory_; }
+  const Statistics& statistics() const { return statistics_; }
+  std::string summary_line() const;
+
+  /* in $GLDEMO_SHADER_CACHE, or else $XDG_CACHE_HOME/gldemo-shaders or ~/.cache/gldemo-shaders */
+  static ProgramCache& shared();
+};
@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+#include "raster.hh"
+
+using namespace std;
+
+namespace {
+
+/* in bytes */
+size_t aligned_size( const size_t size )
+{
+  return ( size + Plane::ROW_ALIGNMENT - 1 ) / Plane::ROW_ALIGNMENT * Plane::ROW_ALIGNMENT;
+}
+
+/* in samples */
+template<typename Sample>
+unsigned int chroma_stride( const unsigned int luma_stride )
+{
+  return BasicPlane<Sample>::aligned_stride( luma_stride / 2 );
+}
+
+}
+
+template<typename Sample>
+void BasicPlane<Sample>::Deleter::operator()( Sample* x ) const
+{
+  free( x );
+}
+
+template<typename Sample>
+BasicPlane<Sample>::BasicPlane( const unsigned int width,
+                                const unsigned int height,
+                                const bool initialize,
+                                unsigned int stride )
+  : width_( width )
+  , height_( height )
+  , stride_( stride ? stride : aligned_stride( width ) )
+  , storage_()
+  , pixels_()
+  , memory_( MemoryKind::Raster, aligned_size( uint64_t( stride_ ) * height_ * sizeof( Sample ) ) )
+{
+  if ( stride_ < width_ or stride_ * sizeof( Sample ) % ROW_ALIGNMENT ) {
+    throw runtime_error( "plane stride must be at least the width and a multiple of "
+                         + to_string( ROW_ALIGNMENT ) + " bytes" );
+  }
+
+  /* aligned_alloc() wants a nonzero multiple of the alignment */
+  storage_.reset( static_cast<Sample*>( aligned_alloc( ROW_ALIGNMENT, max( memory_.bytes(), uint64_t( 1 ) ) ) ) );
+  if ( not storage_ ) {
+    throw bad_alloc();
+  }
+  pixels_ = storage_.get();
+
+  if ( initialize ) {
+    fill_n( pixels_, memory_.bytes() / sizeof( Sample ), DEFAULT_PIXEL_VALUE );
+  }
+}
+
+template<typename Sample>
+BasicPlane<Sample>::BasicPlane( Sample* memory,
+                                const unsigned int width,
+                                const unsigned int height,
+                                unsigned int stride )
+  : width_( width )
+  , height_( height )
+  , stride_( stride ? stride : aligned_stride( width ) )
+  , storage_()
+  , pixels_( memory )
+  , memory_( MemoryKind::Raster, 0 )
+{
+  if ( stride_ < width_ ) {
+    throw runtime_error( "plane stride must be at least the width" );
+  }
+}
+
+template<typename Sample>
+BasicRaster420<Sample>::BasicRaster420( const unsigned int width,
+                                        const unsigned int height,
+                                        const bool initialize,
+                                        const unsigned int luma_stride,
+                                        const unsigned int depth )
+  : Y( width, height, false, luma_stride )
+  , Cb( width / 2, height / 2, false, chroma_stride<Sample>( Y.stride() ) )
+  , Cr( width / 2, height / 2, false, chroma_stride<Sample>( Y.stride() ) )
+  , bit_depth( depth )
+{
+  if ( depth < 8 or depth > 8 * sizeof( Sample ) ) {
+    throw runtime_error( "raster bit depth " + to_string( depth ) + " does not fit its samples" );
+  }
+
+  /* the mid-code of the bit depth, not of the sample type: 512 for 10-bit video, say */
+  if ( initialize ) {
+    const Sample middle = Sample( 1 ) << ( depth - 1 );
+    Y.fill( middle );
+    Cb.fill( middle );
+    Cr.fill( middle );
+  }
+}
+
+template<typename Sample>
+BasicRaster420<Sample>::BasicRaster420( uint8_t* memory,
+                                        const unsigned int width,
+                                        const unsigned int height,
+                                        const unsigned int luma_stride )
+  : Y( reinterpret_cast<Sample*>( memory ),
+       width,
+       height,
+       luma_stride ? luma_stride : BasicPlane<Sample>::aligned_stride( width ) )
+  , Cb( reinterpret_cast<Sample*>( memory + aligned_size( uint64_t( Y.stride() ) * height * sizeof( Sample ) ) ),
+        width / 2,
+        height / 2,
+        chroma_stride<Sample>( Y.stride() ) )
+  , Cr( reinterpret_cast<Sample*>( reinterpret_cast<uint8_t*>( Cb.mutable_pixels() )
+                                   + aligned_size( uint64_t( Cb.stride() ) * ( height / 2 ) * sizeof( Sample ) ) ),
+        width / 2,
+        height / 2,
+        chroma_stride<Sample>( Y.stride() ) )
+{}
+
+template<typename Sample>
+size_t BasicRaster420<Sample>::frame_size( const unsigned int width,
+                                           const unsigned int height,
+                                           const unsigned int luma_stride )
+{
+  const unsigned int Y_stride = luma_stride ? luma_stride : BasicPlane<Sample>::aligned_stride( width );
+  return aligned_size( uint64_t( Y_stride ) * height * sizeof( Sample ) )
+         + 2 * aligned_size( uint64_t( chroma_stride<Sample>( Y_stride ) ) * ( height / 2 ) * sizeof( Sample ) );
+}
+
+template class BasicPlane<uint8_t>;
+template class BasicPlane<uint16_t>;
+template struct BasicRaster420<uint8_t>;
+template struct BasicRaster420<uint16_t>;
+
+RasterNV12::RasterNV12( const unsigned int width,
+                        const unsigned int height,
+                        const bool initialize,
+                        const unsigned int luma_stride )
+  : Y( width, height, initialize, luma_stride )
+  , CbCr( width / 2 * 2, height / 2, initialize, Y.stride() )
+{}
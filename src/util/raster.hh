@@ -0,0 +1,340 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+
+#include "memory_usage.hh"
+
+/* Non-owning view of a rectangle of samples: a whole plane, a crop of one,
+   or memory owned by someone else (e.g. a mapped buffer).
+
+   `stride` is the distance between rows in samples, and (left, top) is the view's
+   position within the plane it was cropped from. Cropping copies nothing. Hot loops
+   should iterate over rows(), which yields one bounded span per row. */
+template<typename T>
+class BasicPlaneView
+{
+  T* pixels_;
+  unsigned int width_, height_, stride_;
+  unsigned int left_, top_;
+
+public:
+  class Row
+  {
+    T* first_;
+    unsigned int width_;
+
+  public:
+    Row( T* first, const unsigned int width )
+      : first_( first )
+      , width_( width )
+    {}
+
+    T* begin() const { return first_; }
+    T* end() const { return first_ + width_; }
+    unsigned int size() const { return width_; }
+    T& operator[]( const unsigned int x ) const { return first_[x]; }
+  };
+
+  class RowIterator
+  {
+    T* row_;
+    unsigned int width_, stride_;
+
+  public:
+    RowIterator( T* row, const unsigned int width, const unsigned int stride )
+      : row_( row )
+      , width_( width )
+      , stride_( stride )
+    {}
+
+    Row operator*() const { return { row_, width_ }; }
+    RowIterator& operator++()
+    {
+      row_ += stride_;
+      return *this;
+    }
+    bool operator!=( const RowIterator& other ) const { return row_ != other.row_; }
+  };
+
+  struct Rows
+  {
+    RowIterator first, last;
+
+    RowIterator begin() const { return first; }
+    RowIterator end() const { return last; }
+  };
+
+  BasicPlaneView( T* pixels,
+                  const unsigned int width,
+                  const unsigned int height,
+                  const unsigned int stride = 0,
+                  const unsigned int left = 0,
+                  const unsigned int top = 0 )
+    : pixels_( pixels )
+    , width_( width )
+    , height_( height )
+    , stride_( stride ? stride : width )
+    , left_( left )
+    , top_( top )
+  {}
+
+  /* a read-only view of a writable one */
+  template<typename U>
+  BasicPlaneView( const BasicPlaneView<U>& other )
+    : BasicPlaneView( other.pixels(), other.width(), other.height(), other.stride(), other.left(), other.top() )
+  {}
+
+  unsigned int width() const { return width_; }
+  unsigned int height() const { return height_; }
+  unsigned int stride() const { return stride_; }
+  unsigned int left() const { return left_; }
+  unsigned int top() const { return top_; }
+
+  T* pixels() const { return pixels_; }
+  T* row( const unsigned int y ) const { return pixels_ + uint64_t( y ) * stride_; }
+
+  Rows rows() const
+  {
+    return { { pixels_, width_, stride_ }, { pixels_ + uint64_t( height_ ) * stride_, width_, stride_ } };
+  }
+
+  T& at( const unsigned int x, const unsigned int y ) const
+  {
+    if ( x >= width_ ) {
+      throw std::out_of_range( "x >= width" );
+    }
+
+    if ( y >= height_ ) {
+      throw std::out_of_range( "y >= height" );
+    }
+
+    return row( y )[x];
+  }
+
+  BasicPlaneView crop( const unsigned int x,
+                       const unsigned int y,
+                       const unsigned int width,
+                       const unsigned int height ) const
+  {
+    if ( x > width_ or width > width_ - x or y > height_ or height > height_ - y ) {
+      throw std::out_of_range( "crop extends outside view" );
+    }
+
+    return { row( y ) + x, width, height, stride_, left_ + x, top_ + y };
+  }
+};
+
+using PlaneView = BasicPlaneView<uint8_t>;
+using ConstPlaneView = BasicPlaneView<const uint8_t>;
+using PlaneView16 = BasicPlaneView<uint16_t>;
+using ConstPlaneView16 = BasicPlaneView<const uint16_t>;
+
+template<typename T>
+struct BasicRaster420View
+{
+  BasicPlaneView<T> Y, Cb, Cr;
+
+  template<typename U>
+  BasicRaster420View( const BasicRaster420View<U>& other )
+    : Y( other.Y )
+    , Cb( other.Cb )
+    , Cr( other.Cr )
+  {}
+
+  BasicRaster420View( const BasicPlaneView<T>& Y_view,
+                      const BasicPlaneView<T>& Cb_view,
+                      const BasicPlaneView<T>& Cr_view )
+    : Y( Y_view )
+    , Cb( Cb_view )
+    , Cr( Cr_view )
+  {}
+
+  /* in luma coordinates, which must be even so the crop holds whole chroma samples */
+  BasicRaster420View crop( const unsigned int x,
+                           const unsigned int y,
+                           const unsigned int width,
+                           const unsigned int height ) const
+  {
+    if ( ( x | y | width | height ) % 2 ) {
+      throw std::out_of_range( "4:2:0 crop must have even position and size" );
+    }
+
+    return { Y.crop( x, y, width, height ),
+             Cb.crop( x / 2, y / 2, width / 2, height / 2 ),
+             Cr.crop( x / 2, y / 2, width / 2, height / 2 ) };
+  }
+};
+
+using Raster420View = BasicRaster420View<uint8_t>;
+using ConstRaster420View = BasicRaster420View<const uint8_t>;
+using Raster420View16 = BasicRaster420View<uint16_t>;
+using ConstRaster420View16 = BasicRaster420View<const uint16_t>;
+
+/* NV12: a plane of Y' and one of interleaved Cb and Cr, as most decoders and capture
+   devices produce. The chroma plane is half the height of the picture and as many samples
+   wide (half the width in Cb/Cr pairs). */
+template<typename T>
+struct BasicRasterNV12View
+{
+  BasicPlaneView<T> Y, CbCr;
+
+  template<typename U>
+  BasicRasterNV12View( const BasicRasterNV12View<U>& other )
+    : Y( other.Y )
+    , CbCr( other.CbCr )
+  {}
+
+  BasicRasterNV12View( const BasicPlaneView<T>& Y_view, const BasicPlaneView<T>& CbCr_view )
+    : Y( Y_view )
+    , CbCr( CbCr_view )
+  {}
+
+  /* in luma coordinates, which must be even so the crop holds whole chroma pairs */
+  BasicRasterNV12View crop( const unsigned int x,
+                            const unsigned int y,
+                            const unsigned int width,
+                            const unsigned int height ) const
+  {
+    if ( ( x | y | width | height ) % 2 ) {
+      throw std::out_of_range( "NV12 crop must have even position and size" );
+    }
+
+    return { Y.crop( x, y, width, height ), CbCr.crop( x, y / 2, width, height / 2 ) };
+  }
+};
+
+using RasterNV12View = BasicRasterNV12View<uint8_t>;
+using ConstRasterNV12View = BasicRasterNV12View<const uint8_t>;
+
+/* Plane of 8- or 16-bit samples.
+
+   Rows start on 64-byte boundaries: `stride` (the distance between rows, in samples)
+   defaults to the width rounded up to a whole number of 64-byte lines. A plane either
+   owns its memory or lays itself out in memory that someone else owns (e.g. a RasterPool). */
+template<typename Sample>
+class BasicPlane
+{
+  /* the middle of the sample type's range */
+  constexpr static Sample DEFAULT_PIXEL_VALUE = Sample( 1 ) << ( 8 * sizeof( Sample ) - 1 );
+
+  struct Deleter
+  {
+    void operator()( Sample* x ) const;
+  };
+
+  unsigned int width_, height_, stride_;
+  std::unique_ptr<Sample, Deleter> storage_;
+  Sample* pixels_;
+  MemoryAccount memory_;
+
+public:
+  constexpr static unsigned int ROW_ALIGNMENT = 64; /* bytes */
+
+  static unsigned int aligned_stride( const unsigned int width )
+  {
+    constexpr unsigned int samples = ROW_ALIGNMENT / sizeof( Sample );
+    return ( width + samples - 1 ) / samples * samples;
+  }
+
+  /* with `initialize` false, the samples are left as whatever the allocator returned */
+  BasicPlane( const unsigned int width,
+              const unsigned int height,
+              const bool initialize = true,
+              unsigned int stride = 0 );
+
+  /* borrow `memory`, which must hold `height` rows of `stride` samples */
+  BasicPlane( Sample* memory, const unsigned int width, const unsigned int height, unsigned int stride = 0 );
+
+  unsigned int width() const { return width_; }
+  unsigned int height() const { return height_; }
+  unsigned int stride() const { return stride_; }
+  uint64_t memory_bytes() const { return memory_.bytes(); }
+  const Sample* pixels() const { return pixels_; }
+  Sample* mutable_pixels() { return pixels_; }
+  const Sample* row( const unsigned int y ) const { return pixels_ + uint64_t( y ) * stride_; }
+  void fill( const Sample value ) { std::fill_n( pixels_, uint64_t( stride_ ) * height_, value ); }
+  Sample* mutable_row( const unsigned int y ) { return pixels_ + uint64_t( y ) * stride_; }
+  BasicPlaneView<Sample> view() { return { pixels_, width_, height_, stride_ }; }
+  BasicPlaneView<const Sample> view() const { return { pixels_, width_, height_, stride_ }; }
+  Sample& at( const unsigned int x, const unsigned int y )
+  {
+    if ( x >= width_ ) {
+      throw std::out_of_range( "x >= width" );
+    }
+
+    if ( y >= height_ ) {
+      throw std::out_of_range( "y >= height" );
+    }
+
+    return mutable_row( y )[x];
+  }
+
+  BasicPlane( BasicPlane&& other ) = default;
+  BasicPlane& operator=( BasicPlane&& other ) = default;
+
+  /* forbid copy */
+  BasicPlane( const BasicPlane& other ) = delete;
+  BasicPlane& operator=( const BasicPlane& other ) = delete;
+};
+
+using Plane = BasicPlane<uint8_t>;
+using Plane16 = BasicPlane<uint16_t>;
+
+/* Raster of 4:2:0 Y'CbCr samples
+   ("4:2:0" means the dimension of Cb and Cr is 1/2 the width and 1/2 the height of Y')
+
+   16-bit rasters hold samples of `bit_depth` bits in the low bits of each sample, as
+   10- and 12-bit video is stored in files (e.g. Y4M's C420p10); the depth is just a tag,
+   carried along to the texture and shader, and nothing is shifted or scaled. */
+template<typename Sample>
+struct BasicRaster420
+{
+  BasicPlane<Sample> Y, Cb, Cr;
+  unsigned int bit_depth = 8 * sizeof( Sample );
+
+public:
+  /* `luma_stride` defaults to the aligned width; the chroma stride follows from it.
+     With `initialize`, every sample starts at the middle of the `depth`-bit range. */
+  BasicRaster420( const unsigned int width,
+                  const unsigned int height,
+                  const bool initialize = true,
+                  const unsigned int luma_stride = 0,
+                  const unsigned int depth = 8 * sizeof( Sample ) );
+
+  /* lay the raster out in `memory`, which must hold frame_size() bytes and be 64-byte aligned */
+  BasicRaster420( uint8_t* memory,
+                  const unsigned int width,
+                  const unsigned int height,
+                  const unsigned int luma_stride = 0 );
+
+  /* in bytes */
+  static size_t frame_size( const unsigned int width, const unsigned int height, const unsigned int luma_stride = 0 );
+
+  uint64_t memory_bytes() const { return Y.memory_bytes() + Cb.memory_bytes() + Cr.memory_bytes(); }
+
+  BasicRaster420View<Sample> view() { return { Y.view(), Cb.view(), Cr.view() }; }
+  BasicRaster420View<const Sample> view() const { return { Y.view(), Cb.view(), Cr.view() }; }
+};
+
+using Raster420 = BasicRaster420<uint8_t>;
+using Raster420_16 = BasicRaster420<uint16_t>;
+
+/* Raster of NV12 (4:2:0, semi-planar) 8-bit Y'CbCr samples; see BasicRasterNV12View */
+struct RasterNV12
+{
+  Plane Y, CbCr;
+
+  /* `luma_stride` defaults to the aligned width; the chroma plane has the same stride */
+  RasterNV12( const unsigned int width,
+              const unsigned int height,
+              const bool initialize = true,
+              const unsigned int luma_stride = 0 );
+
+  uint64_t memory_bytes() const { return Y.memory_bytes() + CbCr.memory_bytes(); }
+
+  RasterNV12View view() { return { Y.view(), CbCr.view() }; }
+  ConstRasterNV12View view() const { return { Y.view(), CbCr.view() }; }
+};
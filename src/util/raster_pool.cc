@@ -0,0 +1,104 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include "raster_pool.hh"
+
+using namespace std;
+
+void RasterPool::Deleter::operator()( uint8_t* x ) const
+{
+  free( x );
+}
+
+RasterPool::RasterPool( const unsigned int width,
+                        const unsigned int height,
+                        const unsigned int frame_count,
+                        const unsigned int luma_stride )
+  : width_( width )
+  , height_( height )
+  , frame_size_( Raster420::frame_size( width, height, luma_stride ) )
+  , arena_( static_cast<uint8_t*>( aligned_alloc( Plane::ROW_ALIGNMENT, max<size_t>( frame_size_ * frame_count, 1 ) ) ) )
+  , memory_( MemoryKind::Raster, uint64_t( frame_size_ ) * frame_count )
+{
+  if ( not arena_ ) {
+    throw bad_alloc();
+  }
+
+  /* fault in every page now, rather than during playback */
+  memset( arena_.get(), 128, memory_.bytes() );
+
+  frames_.reserve( frame_count );
+  free_frames_.reserve( frame_count );
+  for ( unsigned int i = 0; i < frame_count; i++ ) {
+    frames_.emplace_back( arena_.get() + i * frame_size_, width, height, luma_stride );
+    free_frames_.push_back( &frames_.back() );
+  }
+}
+
+RasterPool::Handle RasterPool::acquire()
+{
+  unique_lock<mutex> lock { mutex_ };
+  frame_returned_.wait( lock, [&] { return not free_frames_.empty(); } );
+
+  Raster420* raster = free_frames_.back();
+  free_frames_.pop_back();
+  return { this, raster };
+}
+
+RasterPool::Handle RasterPool::try_acquire()
+{
+  unique_lock<mutex> lock { mutex_ };
+  if ( free_frames_.empty() ) {
+    return {};
+  }
+
+  Raster420* raster = free_frames_.back();
+  free_frames_.pop_back();
+  return { this, raster };
+}
+
+unsigned int RasterPool::available()
+{
+  unique_lock<mutex> lock { mutex_ };
+  return free_frames_.size();
+}
+
+void RasterPool::give_back( Raster420* raster )
+{
+  {
+    unique_lock<mutex> lock { mutex_ };
+    free_frames_.push_back( raster );
+  }
+  frame_returned_.notify_one();
+}
+
+RasterPool::Handle::Handle( Handle&& other )
+  : pool_( other.pool_ )
+  , raster_( other.raster_ )
+{
+  other.pool_ = nullptr;
+  other.raster_ = nullptr;
+}
+
+RasterPool::Handle& RasterPool::Handle::operator=( Handle&& other )
+{
+  if ( this != &other ) {
+    release();
+    pool_ = other.pool_;
+    raster_ = other.raster_;
+    other.pool_ = nullptr;
+    other.raster_ = nullptr;
+  }
+  return *this;
+}
+
+void RasterPool::Handle::release()
+{
+  if ( raster_ ) {
+    pool_->give_back( raster_ );
+    pool_ = nullptr;
+    raster_ = nullptr;
+  }
+}
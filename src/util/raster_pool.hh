@@ -0,0 +1,89 @@
+#pragma once
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "raster.hh"
+
+/* A fixed set of same-sized 4:2:0 frames carved out of one preallocated arena.
+
+   Frames are recycled rather than freed: acquire() hands one out, and the Handle gives
+   it back when it goes away, so steady-state playback allocates (and page-faults)
+   nothing. A recycled frame keeps whatever samples it last held. The pool must
+   outlive its handles. */
+class RasterPool
+{
+public:
+  class Handle
+  {
+    friend class RasterPool;
+
+    RasterPool* pool_ = nullptr;
+    Raster420* raster_ = nullptr;
+
+    Handle( RasterPool* pool, Raster420* raster )
+      : pool_( pool )
+      , raster_( raster )
+    {}
+
+  public:
+    Handle() {}
+    ~Handle() { release(); }
+
+    Handle( Handle&& other );
+    Handle& operator=( Handle&& other );
+
+    /* return the frame to the pool early */
+    void release();
+
+    explicit operator bool() const { return raster_; }
+    Raster420& operator*() const { return *raster_; }
+    Raster420* operator->() const { return raster_; }
+
+    /* forbid copy */
+    Handle( const Handle& other ) = delete;
+    Handle& operator=( const Handle& other ) = delete;
+  };
+
+private:
+  struct Deleter
+  {
+    void operator()( uint8_t* x ) const;
+  };
+
+  unsigned int width_, height_;
+  size_t frame_size_;
+  std::unique_ptr<uint8_t, Deleter> arena_;
+  MemoryAccount memory_;
+  std::vector<Raster420> frames_ {};
+
+  std::mutex mutex_ {};
+  std::condition_variable frame_returned_ {};
+  std::vector<Raster420*> free_frames_ {};
+
+  void give_back( Raster420* raster );
+
+public:
+  RasterPool( const unsigned int width,
+              const unsigned int height,
+              const unsigned int frame_count,
+              const unsigned int luma_stride = 0 );
+
+  /* wait for a free frame */
+  Handle acquire();
+
+  /* empty handle if every frame is in use */
+  Handle try_acquire();
+
+  unsigned int width() const { return width_; }
+  unsigned int height() const { return height_; }
+  unsigned int frame_count() const { return frames_.size(); }
+  unsigned int available();
+  uint64_t memory_bytes() const { return memory_.bytes(); }
+
+  /* forbid copy */
+  RasterPool( const RasterPool& other ) = delete;
+  RasterPool& operator=( const RasterPool& other ) = delete;
+};
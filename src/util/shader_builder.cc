@@ -0,0 +1,93 @@
+#include <algorithm>
+
+#include "shader_builder.hh"
+
+using namespace std;
+using namespace std::chrono;
+
+ShaderBuilder::ShaderBuilder( ProgramCache& cache )
+  : cache_( cache )
+  , parallel_( GLEW_KHR_parallel_shader_compile or GLEW_ARB_parallel_shader_compile )
+{
+  /* let the driver use as many threads as it likes */
+  if ( GLEW_KHR_parallel_shader_compile ) {
+    glMaxShaderCompilerThreadsKHR( 0xFFFFFFFF );
+  } else if ( GLEW_ARB_parallel_shader_compile ) {
+    glMaxShaderCompilerThreadsARB( 0xFFFFFFFF );
+  }
+}
+
+void ShaderBuilder::add( Program& program, const string& vertex_source, const string& fragment_source )
+{
+  if ( pending( program ) ) {
+    throw runtime_error( "ShaderBuilder: program is already being built" );
+  }
+
+  if ( cache_.load( program, vertex_source, fragment_source ) ) {
+    return;
+  }
+
+  Job job { &program,
+            vertex_source,
+            fragment_source,
+            make_unique<VertexShader>( vertex_source ),
+            make_unique<FragmentShader>( fragment_source ),
+            steady_clock::now() };
+
+  program.attach( *job.vertex_shader );
+  program.attach( *job.fragment_shader );
+  if ( cache_.stores_binaries() ) {
+    program.set_binary_retrievable();
+  }
+  program.submit_link();
+
+  pending_.push_back( move( job ) );
+}
+
+/* the job is gone afterwards, even if its program failed */
+void ShaderBuilder::complete( const size_t index )
+{
+  Job job = move( pending_.at( index ) );
+  pending_.erase( pending_.begin() + index );
+
+  job.program->finish_link();
+  cache_.save( *job.program,
+               job.vertex_source,
+               job.fragment_source,
+               duration<double, milli>( steady_clock::now() - job.submitted ).count() );
+}
+
+bool ShaderBuilder::poll()
+{
+  if ( parallel_ ) {
+    for ( size_t i = 0; i < pending_.size(); ) {
+      if ( pending_[i].program->link_complete() ) {
+        complete( i );
+      } else {
+        i++;
+      }
+    }
+  }
+
+  return pending_.empty();
+}
+
+void ShaderBuilder::finish( const Program& program )
+{
+  const auto job = find_if( pending_.begin(), pending_.end(), [&]( const Job& j ) { return j.program == &program; } );
+  if ( job != pending_.end() ) {
+    complete( job - pending_.begin() );
+  }
+}
+
+void ShaderBuilder::finish_all()
+{
+  while ( not pending_.empty() ) {
+    complete( 0 );
+  }
+}
+
+bool ShaderBuilder::pending( const Program& program ) const
+{
+  return any_of( pending_.begin(), pending_.end(), [&]( const Job& j ) { return j.program == &program; } );
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gl_objects.hh"
+#include "program_cache.hh"
+
+/* Builds shader programs in the background, so a set of them can be submitted up front
+   and the first frames drawn while they compile.
+
+   add() hands a program's shaders and link to the driver and returns at once (or links it
+   on the spot from the ProgramCache). With KHR_parallel_shader_compile, poll() asks the
+   driver which builds are done, without waiting, and finishes those; without it there is
+   no way to ask, so each program is finished -- waiting if need be -- by finish() when it
+   is first needed. A program that fails to build throws ShaderError from whichever call
+   finishes it. */
+class ShaderBuilder
+{
+  struct Job
+  {
+    Program* program;
+    std::string vertex_source, fragment_source;
+    std::unique_ptr<VertexShader> vertex_shader;
+    std::unique_ptr<FragmentShader> fragment_shader;
+    std::chrono::steady_clock::time_point submitted;
+  };
+
+  ProgramCache& cache_;
+  bool parallel_;
+  std::vector<Job> pending_ {};
+
+  void complete( const size_t index );
+
+public:
+  explicit ShaderBuilder( ProgramCache& cache = ProgramCache::shared() );
+
+  /* `program` is freshly constructed, and must outlive its build */
+  void add( Program& program, const std::string& vertex_source, const std::string& fragment_source );
+
+  /* finish every build the driver has completed; true once none are pending */
+  bool poll();
+
+  /* finish one program's build, or all of them, waiting as needed */
+  void finish( const Program& program );
+  void finish_all();
+
+  bool pending( const Program& program ) const;
+  size_t pending_count() const { return pending_.size(); }
+
+  /* whether the driver compiles in the background and poll() can see progress */
+  bool parallel() const { return parallel_; }
+};
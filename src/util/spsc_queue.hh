@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+/* Bounded lock-free queue between exactly one producer thread and one consumer thread.
+
+   Each side owns one index and only reads the other's, so a push or pop is a couple of
+   loads and one release store. The indices sit on separate cache lines so the two
+   threads don't invalidate each other's line on every operation. */
+template<typename T>
+class SPSCQueue
+{
+  std::vector<std::optional<T>> slots_;
+  size_t mask_;
+
+  alignas( 64 ) std::atomic<size_t> head_ { 0 }; /* next to pop; written by the consumer */
+  alignas( 64 ) std::atomic<size_t> tail_ { 0 }; /* next to push; written by the producer */
+
+public:
+  /* `capacity` must be a power of two */
+  explicit SPSCQueue( const size_t capacity )
+    : slots_( capacity )
+    , mask_( capacity - 1 )
+  {
+    if ( capacity == 0 or ( capacity & mask_ ) ) {
+      throw std::invalid_argument( "SPSCQueue capacity must be a power of two" );
+    }
+  }
+
+  /* producer only; false if the queue is full */
+  bool try_push( T&& item )
+  {
+    const size_t tail = tail_.load( std::memory_order_relaxed );
+    if ( tail - head_.load( std::memory_order_acquire ) == slots_.size() ) {
+      return false;
+    }
+
+    slots_[tail & mask_].emplace( std::move( item ) );
+    tail_.store( tail + 1, std::memory_order_release );
+    return true;
+  }
+
+  /* consumer only; empty if the queue is */
+  std::optional<T> try_pop()
+  {
+    const size_t head = head_.load( std::memory_order_relaxed );
+    if ( head == tail_.load( std::memory_order_acquire ) ) {
+      return {};
+    }
+
+    std::optional<T> item = std::move( slots_[head & mask_] );
+    slots_[head & mask_].reset();
+    head_.store( head + 1, std::memory_order_release );
+    return item;
+  }
+
+  /* approximate unless called from one of the two threads with the other idle */
+  size_t size() const { return tail_.load( std::memory_order_acquire ) - head_.load( std::memory_order_acquire ); }
+  size_t capacity() const { return slots_.size(); }
+
+  /* forbid copy */
+  SPSCQueue( const SPSCQueue& other ) = delete;
+  SPSCQueue& operator=( const SPSCQueue& other ) = delete;
+};
@@ -0,0 +1,85 @@
+#include "text_cache.hh"
+
+using namespace std;
+
+namespace {
+
+/* the path dominates; the rest is the key, the list node and the Text itself */
+size_t entry_memory_bytes( const string& key, const Pango::Text& text )
+{
+  const cairo_path_t* path = text;
+  return path->num_data * sizeof( cairo_path_data_t ) + sizeof( cairo_path_t ) + 2 * key.size() + 128;
+}
+
+}
+
+TextCache::TextCache( const size_t memory_cap )
+  : memory_cap_( memory_cap )
+{}
+
+shared_ptr<const Pango::Text> TextCache::get( const Pango::Font& font, const string& markup )
+{
+  string key = font.description();
+  key.push_back( '\0' );
+  key.append( markup );
+
+  {
+    unique_lock<mutex> lock { mutex_ };
+
+    const auto found = index_.find( key );
+    if ( found != index_.end() ) {
+      hits_++;
+      entries_.splice( entries_.begin(), entries_, found->second );
+      return found->second->text;
+    }
+
+    misses_++;
+  }
+
+  /* shape without holding the cache lock (Text takes the global Pango lock itself) */
+  auto text = make_shared<const Pango::Text>( scratch_, pango_, font, markup );
+  const size_t memory_bytes = entry_memory_bytes( key, *text );
+
+  unique_lock<mutex> lock { mutex_ };
+
+  /* another thread may have shaped the same text meanwhile */
+  const auto found = index_.find( key );
+  if ( found != index_.end() ) {
+    entries_.splice( entries_.begin(), entries_, found->second );
+    return found->second->text;
+  }
+
+  entries_.push_front( { key, text, memory_bytes } );
+  index_.emplace( move( key ), entries_.begin() );
+  memory_bytes_ += memory_bytes;
+
+  evict_to( memory_cap_ );
+
+  return text;
+}
+
+/* always keeps the most recent entry, even if it alone exceeds the cap */
+void TextCache::evict_to( const size_t memory_bytes )
+{
+  while ( memory_bytes_ > memory_bytes and entries_.size() > 1 ) {
+    const Entry& victim = entries_.back();
+    memory_bytes_ -= victim.memory_bytes;
+    index_.erase( victim.key );
+    entries_.pop_back();
+    evictions_++;
+  }
+}
+
+TextCache::Statistics TextCache::statistics() const
+{
+  unique_lock<mutex> lock { mutex_ };
+  return { hits_, misses_, evictions_, entries_.size(), memory_bytes_ };
+}
+
+void TextCache::clear()
+{
+  unique_lock<mutex> lock { mutex_ };
+  index_.clear();
+  entries_.clear();
+  memory_bytes_ = 0;
+}
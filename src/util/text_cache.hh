@@ -0,0 +1,61 @@
+#pragma once
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "cairo_objects.hh"
+
+/* Bounded LRU cache of shaped text, keyed by font description and markup.
+
+   Entries are immutable and shared: a Text stays valid for as long as a caller holds it,
+   even after it has been evicted. The cache's own lock is only held to look up or insert
+   an entry, never while shaping, so hits proceed while another thread is shaping a miss
+   (under the global Pango lock). Two threads that miss on the same key at once both shape
+   it, and the first to finish is kept. */
+class TextCache
+{
+public:
+  struct Statistics
+  {
+    uint64_t hits, misses, evictions;
+    size_t entries, memory_bytes;
+  };
+
+private:
+  struct Entry
+  {
+    std::string key;
+    std::shared_ptr<const Pango::Text> text;
+    size_t memory_bytes;
+  };
+
+  size_t memory_cap_;
+
+  /* everything below is guarded by mutex_ */
+  mutable std::mutex mutex_ {};
+  std::list<Entry> entries_ {}; /* most recently used first */
+  std::unordered_map<std::string, std::list<Entry>::iterator> index_ {};
+  size_t memory_bytes_ = 0;
+  uint64_t hits_ = 0, misses_ = 0, evictions_ = 0;
+
+  /* shaping draws into a context of its own, used only under the global Pango lock */
+  Cairo scratch_ { 1, 1 };
+  Pango pango_ { scratch_ };
+
+  void evict_to( const size_t memory_bytes );
+
+public:
+  explicit TextCache( const size_t memory_cap = 16 << 20 );
+
+  std::shared_ptr<const Pango::Text> get( const Pango::Font& font, const std::string& markup );
+
+  Statistics statistics() const;
+  void clear();
+
+  /* forbid copy */
+  TextCache( const TextCache& other ) = delete;
+  TextCache& operator=( const TextCache& other ) = delete;
+};
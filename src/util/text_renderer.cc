@@ -0,0 +1,353 @@
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <mutex>
+
+#include "program_cache.hh"
+#include "text_renderer.hh"
+
+using namespace std;
+
+namespace {
+
+const string text_vertex_shader_source = R"( #version 130
+
+      uniform uvec2 window_size;
+
+      in vec2 position;
+      in vec2 atlas_texcoord;
+      in vec4 color;
+      out vec2 texcoord;
+      out vec4 text_color;
+
+      void main()
+      {
+        gl_Position = vec4( 2 * position.x / window_size.x - 1.0,
+                            1.0 - 2 * position.y / window_size.y, 0.0, 1.0 );
+        texcoord = atlas_texcoord;
+        text_color = color;
+      }
+    )";
+
+/* the color arrives premultiplied, so coverage scales all four components */
+const string text_fragment_shader_source = R"( #version 130
+      #extension GL_ARB_texture_rectangle : enable
+
+      uniform sampler2DRect atlas;
+
+      in vec2 texcoord;
+      in vec4 text_color;
+      out vec4 outColor;
+
+      void main()
+      {
+        outColor = text_color * texture(atlas, texcoord).r;
+      }
+    )";
+
+/* the video uses units 0-2 */
+constexpr GLenum ATLAS_TEXTURE_UNIT = GL_TEXTURE3;
+
+/* transparent border around each glyph, so linear filtering never reaches a neighbour */
+constexpr int GLYPH_PADDING = 1;
+
+}
+
+size_t TextRenderer::GlyphKeyHash::operator()( const GlyphKey& key ) const
+{
+  return hash<string>()( key.font ) * 31 + key.glyph;
+}
+
+TextRenderer::TextRenderer( const unsigned int atlas_size )
+  : atlas_pixels_( atlas_size, atlas_size )
+  , atlas_( atlas_size, atlas_size )
+  , program_( text_vertex_shader_source, text_fragment_shader_source, ProgramCache::shared() )
+{
+  glCheck( "after linking text shader program" );
+
+  vertex_array_.bind();
+  ArrayBuffer::bind( vertex_buffer_ );
+
+  const GLint position = program_.attribute_location( "position" );
+  const GLint texcoord = program_.attribute_location( "atlas_texcoord" );
+  const GLint color = program_.attribute_location( "color" );
+
+  glVertexAttribPointer( position, 2, GL_FLOAT, GL_FALSE, sizeof( TextVertex ), 0 );
+  glVertexAttribPointer(
+    texcoord, 2, GL_FLOAT, GL_FALSE, sizeof( TextVertex ), (const void*)( offsetof( TextVertex, u ) ) );
+  glVertexAttribPointer(
+    color, 4, GL_FLOAT, GL_FALSE, sizeof( TextVertex ), (const void*)( offsetof( TextVertex, color ) ) );
+  glEnableVertexAttribArray( position );
+  glEnableVertexAttribArray( texcoord );
+  glEnableVertexAttribArray( color );
+
+  program_.use();
+  Uniform<GLint>( program_, "atlas" ).set( ATLAS_TEXTURE_UNIT - GL_TEXTURE0 );
+
+  /* start with an empty (zero-coverage) atlas */
+  memset( atlas_pixels_.mutable_pixels(), 0, atlas_pixels_.memory_bytes() );
+  atlas_.load( atlas_pixels_, ATLAS_TEXTURE_UNIT );
+
+  glCheck( "TextRenderer constructor" );
+}
+
+void TextRenderer::reset_atlas()
+{
+  glyphs_.clear();
+  shelf_x_ = shelf_y_ = shelf_height_ = 0;
+  generation_++;
+}
+
+const TextRenderer::AtlasEntry& TextRenderer::glyph( PangoFont* font,
+                                                     const string& font_description,
+                                                     const PangoGlyph glyph )
+{
+  GlyphKey key { font_description, glyph };
+  const auto existing = glyphs_.find( key );
+  if ( existing != glyphs_.end() ) {
+    return existing->second;
+  }
+
+  /* ink rectangle, in pixels relative to the glyph origin on the baseline */
+  PangoRectangle ink;
+  pango_font_get_glyph_extents( font, glyph, &ink, nullptr );
+
+  const int left = floor( ink.x / double( PANGO_SCALE ) ) - GLYPH_PADDING;
+  const int top = floor( ink.y / double( PANGO_SCALE ) ) - GLYPH_PADDING;
+  const int right = ceil( ( ink.x + ink.width ) / double( PANGO_SCALE ) ) + GLYPH_PADDING;
+  const int bottom = ceil( ( ink.y + ink.height ) / double( PANGO_SCALE ) ) + GLYPH_PADDING;
+
+  AtlasEntry entry { 0, 0, unsigned( right - left ), unsigned( bottom - top ), left, top };
+
+  /* glyphs with no ink (spaces) take no room */
+  if ( ink.width <= 0 or ink.height <= 0 ) {
+    entry.width = entry.height = 0;
+    return glyphs_.emplace( move( key ), entry ).first->second;
+  }
+
+  if ( entry.width > atlas_pixels_.width() or entry.height > atlas_pixels_.height() ) {
+    throw runtime_error( "glyph of " + to_string( entry.width ) + "x" + to_string( entry.height )
+                         + " pixels is larger than the glyph atlas" );
+  }
+
+  /* shelf packing: left to right, then start a new shelf below the tallest glyph so far */
+  if ( shelf_x_ + entry.width > atlas_pixels_.width() ) {
+    shelf_x_ = 0;
+    shelf_y_ += shelf_height_;
+    shelf_height_ = 0;
+  }
+
+  if ( shelf_y_ + entry.height > atlas_pixels_.height() ) {
+    throw AtlasFull {};
+  }
+
+  entry.x = shelf_x_;
+  entry.y = shelf_y_;
+  shelf_x_ += entry.width;
+  shelf_height_ = max( shelf_height_, entry.height );
+
+  /* the rare glyph too big for the scratch surface gets a surface of its own */
+  unique_ptr<Cairo> large_scratch;
+  if ( entry.width > SCRATCH_SIZE or entry.height > SCRATCH_SIZE ) {
+    large_scratch = make_unique<Cairo>( entry.width, entry.height );
+  }
+  Cairo& scratch = large_scratch ? *large_scratch : scratch_;
+
+  /* white on black in the scratch surface; any channel is then the coverage */
+  cairo_identity_matrix( scratch );
+  cairo_set_operator( scratch, CAIRO_OPERATOR_SOURCE );
+  cairo_set_source_rgba( scratch, 0, 0, 0, 1 );
+  cairo_paint( scratch );
+  cairo_set_operator( scratch, CAIRO_OPERATOR_OVER );
+  cairo_set_source_rgba( scratch, 1, 1, 1, 1 );
+  cairo_move_to( scratch, -left, -top );
+
+  PangoGlyphInfo info {};
+  info.glyph = glyph;
+  int cluster = 0;
+  PangoGlyphString glyph_string {};
+  glyph_string.num_glyphs = 1;
+  glyph_string.glyphs = &info;
+  glyph_string.log_clusters = &cluster;
+  pango_cairo_show_glyph_string( scratch, font, &glyph_string );
+  scratch.flush();
+
+  for ( unsigned int y = 0; y < entry.height; y++ ) {
+    const uint8_t* source = scratch.pixels() + y * scratch.stride();
+    uint8_t* destination = atlas_pixels_.mutable_row( entry.y + y ) + entry.x;
+    for ( unsigned int x = 0; x < entry.width; x++ ) {
+      destination[x] = source[4 * x + 1];
+    }
+  }
+
+  atlas_.load( ConstPlaneView { atlas_pixels_.view() }.crop( entry.x, entry.y, entry.width, entry.height ),
+               ATLAS_TEXTURE_UNIT );
+
+  return glyphs_.emplace( move( key ), entry ).first->second;
+}
+
+void TextRenderer::shape( Layout& layout )
+{
+  for ( unsigned int attempt = 0; attempt < 2; attempt++ ) {
+    try {
+      unique_lock<mutex> ul { global_pango_mutex() };
+
+      const Pango::Font font { layout.font_description_ };
+      pango_.set_font( font );
+      pango_layout_set_markup( pango_, layout.markup_.data(), layout.markup_.size() );
+
+      layout.glyphs_.clear();
+
+      PangoLayoutIter* iter = pango_layout_get_iter( pango_ );
+      try {
+        do {
+          PangoLayoutRun* run = pango_layout_iter_get_run_readonly( iter );
+          if ( not run ) {
+            continue; /* end of a line */
+          }
+
+          PangoRectangle run_extent;
+          pango_layout_iter_get_run_extents( iter, nullptr, &run_extent );
+          const float baseline = pango_layout_iter_get_baseline( iter ) / float( PANGO_SCALE );
+
+          const Pango::Font run_font { pango_font_describe( run->item->analysis.font ) };
+          const string run_font_description = run_font.description();
+
+          int x = run_extent.x;
+          for ( int i = 0; i < run->glyphs->num_glyphs; i++ ) {
+            const PangoGlyphInfo& info = run->glyphs->glyphs[i];
+
+            if ( info.glyph != PANGO_GLYPH_EMPTY and not( info.glyph & PANGO_GLYPH_UNKNOWN_FLAG ) ) {
+              const AtlasEntry& entry = glyph( run->item->analysis.font, run_font_description, info.glyph );
+              if ( entry.width ) {
+                layout.glyphs_.push_back( { ( x + info.geometry.x_offset ) / float( PANGO_SCALE ),
+                                            baseline + info.geometry.y_offset / float( PANGO_SCALE ),
+                                            &entry } );
+              }
+            }
+
+            x += info.geometry.width;
+          }
+        } while ( pango_layout_iter_next_run( iter ) );
+      } catch ( ... ) {
+        pango_layout_iter_free( iter );
+        throw;
+      }
+      pango_layout_iter_free( iter );
+
+      PangoRectangle logical;
+      pango_layout_get_extents( pango_, nullptr, &logical );
+      layout.extent_ = { logical.x / double( PANGO_SCALE ),
+                         logical.y / double( PANGO_SCALE ),
+                         logical.width / double( PANGO_SCALE ),
+                         logical.height / double( PANGO_SCALE ) };
+
+      layout.generation_ = generation_;
+      return;
+    } catch ( const AtlasFull& ) {
+      reset_atlas();
+    }
+  }
+
+  throw runtime_error( "text does not fit in the glyph atlas: " + layout.markup_ );
+}
+
+TextRenderer::Layout TextRenderer::layout( const Pango::Font& font, const string& markup )
+{
+  Layout result { font.description(), markup };
+  shape( result );
+  return result;
+}
+
+void TextRenderer::draw( Layout& layout, const float x, const float y, const Color& color )
+{
+  queue_.push_back( { &layout, x, y, color } );
+}
+
+/* Bring every queued layout up to the current atlas. A reset while shaping one makes those
+   shaped before it stale, so go round again; by then the atlas holds only this frame's
+   glyphs, and another reset means they can't all be in it at once. */
+void TextRenderer::shape_queued()
+{
+  try {
+    for ( unsigned int pass = 0; pass < 2; pass++ ) {
+      const uint64_t generation = generation_;
+
+      for ( const auto& queued : queue_ ) {
+        if ( queued.layout->generation_ != generation_ ) {
+          shape( *queued.layout );
+        }
+      }
+
+      if ( generation_ == generation ) {
+        return;
+      }
+    }
+  } catch ( ... ) {
+    queue_.clear();
+    throw;
+  }
+
+  queue_.clear();
+  throw runtime_error( "text drawn in one frame does not fit in the glyph atlas" );
+}
+
+void TextRenderer::build_batch()
+{
+  batch_.clear();
+
+  for ( const auto& [layout, x, y, color] : queue_ ) {
+    const Color premultiplied {
+      color.red * color.alpha, color.green * color.alpha, color.blue * color.alpha, color.alpha
+    };
+
+    for ( const auto& placed : layout->glyphs_ ) {
+      const AtlasEntry& entry = *placed.entry;
+
+      /* whole pixels, so the atlas is sampled texel for texel */
+      const float left = roundf( x + placed.x ) + entry.left;
+      const float top = roundf( y + placed.y ) + entry.top;
+      const float right = left + entry.width, bottom = top + entry.height;
+
+      const float u0 = entry.x, v0 = entry.y;
+      const float u1 = entry.x + entry.width, v1 = entry.y + entry.height;
+
+      batch_.insert( batch_.end(),
+                     { { left, top, u0, v0, premultiplied },
+                       { left, bottom, u0, v1, premultiplied },
+                       { right, bottom, u1, v1, premultiplied },
+                       { left, top, u0, v0, premultiplied },
+                       { right, bottom, u1, v1, premultiplied },
+                       { right, top, u1, v0, premultiplied } } );
+    }
+  }
+
+  queue_.clear();
+}
+
+void TextRenderer::render( const unsigned int window_width, const unsigned int window_height )
+{
+  if ( queue_.empty() ) {
+    return;
+  }
+
+  shape_queued();
+  build_batch();
+
+  program_.use();
+  window_size_.set( { window_width, window_height } );
+
+  vertex_array_.bind();
+  ArrayBuffer::bind( vertex_buffer_ );
+  ArrayBuffer::load( batch_, GL_STREAM_DRAW );
+
+  atlas_.bind( ATLAS_TEXTURE_UNIT );
+
+  glEnable( GL_BLEND );
+  glBlendFunc( GL_ONE, GL_ONE_MINUS_SRC_ALPHA );
+  glDrawArrays( GL_TRIANGLES, 0, batch_.size() );
+  glDisable( GL_BLEND );
+
+  glCheck( "TextRenderer::render" );
+}
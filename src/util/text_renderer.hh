@@ -0,0 +1,136 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "cairo_objects.hh"
+#include "gl_objects.hh"
+
+/* Text drawn on the GPU from a cache of rasterized glyphs.
+
+   Pango only shapes the text; each glyph is rasterized once, the first time it is used
+   in a given font, into an 8-bit coverage atlas texture. Drawing a layout queues it, and
+   render() turns the queue into one textured quad per glyph and draws them all, blended
+   over whatever is already in the framebuffer, with one buffer upload and one draw call.
+
+   If the atlas fills up, it is cleared and refilled with only the glyphs in use; render()
+   reshapes every layout of the frame against the refilled atlas before building any
+   quads. A glyph larger than the atlas itself can't be drawn, and shaping text that uses
+   one throws, as does a frame whose glyphs don't fit in the atlas together. */
+class TextRenderer
+{
+  /* where a glyph's bitmap sits in the atlas, and its offset from the glyph origin */
+  struct AtlasEntry
+  {
+    unsigned int x, y, width, height;
+    int left, top;
+  };
+
+public:
+  class Layout
+  {
+    friend class TextRenderer;
+
+    struct PlacedGlyph
+    {
+      float x, y; /* origin, in pixels relative to the top-left of the layout */
+      const AtlasEntry* entry;
+    };
+
+    std::string font_description_;
+    std::string markup_;
+    std::vector<PlacedGlyph> glyphs_ {};
+    Cairo::Extent<false> extent_ { 0, 0, 0, 0 };
+    uint64_t generation_ = 0;
+
+  public:
+    Layout( const std::string& font_description, const std::string& markup )
+      : font_description_( font_description )
+      , markup_( markup )
+    {}
+
+    /* logical extent, in pixels */
+    const Cairo::Extent<false>& extent() const { return extent_; }
+    const std::string& markup() const { return markup_; }
+  };
+
+  struct Color
+  {
+    float red, green, blue, alpha;
+  };
+
+private:
+  struct GlyphKey
+  {
+    std::string font;
+    PangoGlyph glyph;
+
+    bool operator==( const GlyphKey& other ) const { return glyph == other.glyph and font == other.font; }
+  };
+
+  struct GlyphKeyHash
+  {
+    size_t operator()( const GlyphKey& key ) const;
+  };
+
+  struct TextVertex
+  {
+    float x, y, u, v;
+    Color color;
+  };
+
+  struct QueuedLayout
+  {
+    Layout* layout;
+    float x, y;
+    Color color;
+  };
+
+  struct AtlasFull
+  {};
+
+  /* glyphs up to this size are rasterized in a surface kept for it; bigger ones in a temporary one */
+  constexpr static unsigned int SCRATCH_SIZE = 256;
+
+  Cairo scratch_ { SCRATCH_SIZE, SCRATCH_SIZE };
+  Pango pango_ { scratch_ };
+
+  Plane atlas_pixels_;
+  Texture atlas_;
+  std::unordered_map<GlyphKey, AtlasEntry, GlyphKeyHash> glyphs_ {};
+  unsigned int shelf_x_ = 0, shelf_y_ = 0, shelf_height_ = 0;
+  uint64_t generation_ = 1;
+
+  Program program_;
+  Uniform<glsl::uvec2> window_size_ { program_, "window_size" };
+  VertexArrayObject vertex_array_ {};
+  VertexBufferObject vertex_buffer_ {};
+  std::vector<QueuedLayout> queue_ {};
+  std::vector<TextVertex> batch_ {};
+
+  const AtlasEntry& glyph( PangoFont* font, const std::string& font_description, const PangoGlyph glyph );
+  void reset_atlas();
+  void shape( Layout& layout );
+  void shape_queued();
+  void build_batch();
+
+public:
+  /* the atlas is `atlas_size` square; must be called with the GL context current */
+  explicit TextRenderer( const unsigned int atlas_size = 1024 );
+
+  Layout layout( const Pango::Font& font, const std::string& markup );
+
+  /* queue a layout with its top-left at (x, y) in window pixels; it must outlive the next render() */
+  void draw( Layout& layout, const float x, const float y, const Color& color );
+
+  /* draw everything queued since the last render(), in a window of the given size */
+  void render( const unsigned int window_width, const unsigned int window_height );
+
+  size_t glyph_count() const { return glyphs_.size(); }
+  uint64_t atlas_resets() const { return generation_ - 1; }
+
+  /* forbid copy */
+  TextRenderer( const TextRenderer& other ) = delete;
+  TextRenderer& operator=( const TextRenderer& other ) = delete;
+};
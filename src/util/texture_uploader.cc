@@ -0,0 +1,135 @@
+#include "texture_uploader.hh"
+
+using namespace std;
+
+TextureUploader::TextureUploader( const Window& display_window,
+                                  const unsigned int width,
+                                  const unsigned int height,
+                                  const unsigned int textures )
+  : context_( display_window, "texture uploader" )
+{
+  if ( textures < 2 ) {
+    throw runtime_error( "TextureUploader needs at least two textures" );
+  }
+
+  /* created in the display's context; the names are shared with the upload thread's */
+  for ( unsigned int i = 0; i < textures; i++ ) {
+    slots_.push_back( make_unique<Slot>( width, height ) );
+    free_.push_back( i );
+  }
+
+  /* everything created so far must be visible to the other context */
+  glFlush();
+
+  thread_ = thread { [&] { upload_loop(); } };
+}
+
+TextureUploader::~TextureUploader()
+{
+  {
+    unique_lock<mutex> lock { mutex_ };
+    stopping_ = true;
+  }
+  wakeup_.notify_all();
+  thread_.join();
+}
+
+void TextureUploader::upload_loop()
+{
+  try {
+    context_.make_context_current( false );
+
+    while ( true ) {
+      unique_lock<mutex> lock { mutex_ };
+      wakeup_.wait( lock, [&] { return stopping_ or not jobs_.empty(); } );
+      if ( stopping_ ) {
+        break;
+      }
+      const Job job = jobs_.front();
+      jobs_.pop_front();
+      lock.unlock();
+
+      Slot& slot = *slots_.at( job.slot );
+
+      /* don't overwrite the texture until the display has finished drawing from it */
+      slot.released.wait_on_gpu();
+
+      slot.texture.load( job.frame );
+      slot.texture.colorimetry = {};
+
+      /* the flush makes the fence (and the upload) visible to the display's context */
+      slot.uploaded.insert();
+      glFlush();
+      glCheck( "TextureUploader upload" );
+
+      lock.lock();
+      uploaded_.push_back( { job.id, &slot.texture, job.slot } );
+    }
+  } catch ( ... ) {
+    unique_lock<mutex> lock { mutex_ };
+    error_ = current_exception();
+  }
+
+  glfwMakeContextCurrent( nullptr );
+}
+
+bool TextureUploader::accepting()
+{
+  unique_lock<mutex> lock { mutex_ };
+  return not free_.empty();
+}
+
+bool TextureUploader::submit( const uint64_t id, const ConstRaster420View& frame )
+{
+  if ( frame.Y.width() != slots_.front()->texture.Y.width()
+       or frame.Y.height() != slots_.front()->texture.Y.height() ) {
+    throw runtime_error( "TextureUploader: frame's dimensions don't match the textures'" );
+  }
+
+  {
+    unique_lock<mutex> lock { mutex_ };
+    if ( free_.empty() ) {
+      return false;
+    }
+
+    jobs_.push_back( { id, free_.back(), frame } );
+    free_.pop_back();
+  }
+
+  wakeup_.notify_one();
+  return true;
+}
+
+optional<TextureUploader::Frame> TextureUploader::acquire()
+{
+  optional<Frame> frame;
+  {
+    unique_lock<mutex> lock { mutex_ };
+    if ( error_ ) {
+      rethrow_exception( error_ );
+    }
+
+    if ( uploaded_.empty() ) {
+      return frame;
+    }
+
+    frame = uploaded_.front();
+    uploaded_.pop_front();
+  }
+
+  /* draws issued from here on wait for the upload to land */
+  slots_.at( frame->slot )->uploaded.wait_on_gpu();
+  return frame;
+}
+
+void TextureUploader::release( const Frame& frame )
+{
+  Slot& slot = *slots_.at( frame.slot );
+
+  /* the upload thread waits on this before reusing the texture; flush so it can */
+  slot.released.insert();
+  glFlush();
+
+  unique_lock<mutex> lock { mutex_ };
+  free_.push_back( frame.slot );
+}
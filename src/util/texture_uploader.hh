@@ -0,0 +1,94 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "gl_objects.hh"
+
+/* Uploads 4:2:0 frames into textures on a thread of its own, so the thread that presents
+   only binds and draws.
+
+   The upload thread has a hidden context that shares objects with the display's, and a
+   fixed set of Texture420s to upload into. Each finished upload is fenced and flushed
+   before the texture is handed over; acquire() makes the display's context wait on that
+   fence on the GPU, never the CPU. Going back, release() fences the display's last draw
+   from the texture, and the upload thread waits on that before overwriting it.
+
+   submit(), acquire() and release() are called on the thread whose context is current
+   with the display; the uploader is constructed and destroyed there too. */
+class TextureUploader
+{
+public:
+  struct Frame
+  {
+    uint64_t id;
+    Texture420* texture;
+    unsigned int slot; /* the uploader's; pass the Frame back to release() */
+  };
+
+private:
+  struct Slot
+  {
+    Texture420 texture;
+    Fence uploaded {}; /* inserted by the upload thread */
+    Fence released {}; /* inserted by the display's thread */
+
+    Slot( const unsigned int width, const unsigned int height )
+      : texture( width, height )
+    {}
+  };
+
+  struct Job
+  {
+    uint64_t id;
+    unsigned int slot;
+    ConstRaster420View frame;
+  };
+
+  Window context_;
+  std::vector<std::unique_ptr<Slot>> slots_ {};
+
+  /* everything below is guarded by mutex_ */
+  std::mutex mutex_ {};
+  std::condition_variable wakeup_ {};
+  std::vector<unsigned int> free_ {}; /* slots available to upload into */
+  std::deque<Job> jobs_ {};           /* submitted, not yet uploaded */
+  std::deque<Frame> uploaded_ {};     /* uploaded, in order of submission */
+  bool stopping_ = false;
+  std::exception_ptr error_ {};
+
+  std::thread thread_ {};
+
+  void upload_loop();
+
+public:
+  /* `textures` bounds the frames submitted, uploaded and held by the caller at once */
+  TextureUploader( const Window& display_window,
+                   const unsigned int width,
+                   const unsigned int height,
+                   const unsigned int textures = 4 );
+  ~TextureUploader();
+
+  /* whether submit() would accept a frame now */
+  bool accepting();
+
+  /* Queue a frame for upload; false (and not queued) if every texture is in use. The frame's
+     memory must stay valid until the frame comes back from acquire(). */
+  bool submit( const uint64_t id, const ConstRaster420View& frame );
+
+  /* the oldest frame uploaded and not yet acquired, if any; rethrows an error from the upload thread */
+  std::optional<Frame> acquire();
+
+  /* return a frame's texture for reuse, once everything drawn from it has been issued */
+  void release( const Frame& frame );
+
+  /* forbid copy */
+  TextureUploader( const TextureUploader& other ) = delete;
+  TextureUploader& operator=( const TextureUploader& other ) = delete;
+};
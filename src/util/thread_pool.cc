@@ -0,0 +1,224 @@
+#include <algorithm>
+#include <exception>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+
+#include "thread_pool.hh"
+
+using namespace std;
+
+ThreadPool::ThreadPool( const unsigned int thread_count )
+  : queues_( max( 1u, thread_count ) - 1 )
+{
+  for ( unsigned int i = 0; i < queues_.size(); i++ ) {
+    workers_.emplace_back( [this, i] { work( i ); } );
+  }
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    unique_lock<mutex> lock { sleep_mutex_ };
+    shutting_down_ = true;
+  }
+  wakeup_.notify_all();
+
+  for ( auto& worker : workers_ ) {
+    worker.join();
+  }
+}
+
+bool ThreadPool::run_one( const unsigned int preferred_queue )
+{
+  if ( queued_ == 0 ) {
+    return false;
+  }
+
+  for ( unsigned int i = 0; i < queues_.size(); i++ ) {
+    const bool own_queue = ( i == 0 );
+    WorkQueue& queue = queues_.at( ( preferred_queue + i ) % queues_.size() );
+
+    function<void()> task;
+    {
+      unique_lock<mutex> lock { queue.mutex };
+      if ( queue.tasks.empty() ) {
+        continue;
+      }
+
+      if ( own_queue ) {
+        task = move( queue.tasks.back() );
+        queue.tasks.pop_back();
+      } else {
+        task = move( queue.tasks.front() );
+        queue.tasks.pop_front();
+      }
+    }
+
+    queued_--;
+    task();
+    return true;
+  }
+
+  return false;
+}
+
+void ThreadPool::work( const unsigned int index )
+{
+  while ( true ) {
+    if ( run_one( index ) ) {
+      continue;
+    }
+
+    unique_lock<mutex> lock { sleep_mutex_ };
+    wakeup_.wait( lock, [&] { return shutting_down_ or queued_ > 0; } );
+
+    if ( shutting_down_ and queued_ == 0 ) {
+      return;
+    }
+  }
+}
+
+void ThreadPool::parallel_for( const unsigned int begin,
+                               const unsigned int end,
+                               const Range& body,
+                               const unsigned int grain )
+{
+  if ( begin >= end ) {
+    return;
+  }
+
+  if ( grain == 0 ) {
+    throw runtime_error( "parallel_for: grain must be positive" );
+  }
+
+  /* a few chunks per thread, so that stealing can even out uneven work */
+  const unsigned int grains = ( end - begin + grain - 1 ) / grain;
+  const unsigned int chunks = min( grains, 4 * thread_count() );
+
+  if ( chunks <= 1 or workers_.empty() ) {
+    body( begin, end );
+    return;
+  }
+
+  struct Batch
+  {
+    atomic<unsigned int> remaining;
+    mutex done_mutex {};
+    condition_variable done {};
+    mutex error_mutex {};
+    exception_ptr error {};
+
+    explicit Batch( const unsigned int count )
+      : remaining( count )
+    {}
+  } batch { chunks };
+
+  const auto boundary = [&]( const unsigned int chunk ) {
+    return unsigned( min( uint64_t( end ), begin + uint64_t( grain ) * ( uint64_t( grains ) * chunk / chunks ) ) );
+  };
+
+  const unsigned int first_queue = next_queue_++;
+
+  /* count the tasks first, so a worker that takes one never sees the counter go below zero */
+  queued_ += chunks;
+
+  for ( unsigned int i = 0; i < chunks; i++ ) {
+    const unsigned int chunk_begin = boundary( i );
+    const unsigned int chunk_end = boundary( i + 1 );
+
+    WorkQueue& queue = queues_.at( ( first_queue + i ) % queues_.size() );
+    unique_lock<mutex> lock { queue.mutex };
+    queue.tasks.emplace_back( [&batch, &body, chunk_begin, chunk_end] {
+      try {
+        body( chunk_begin, chunk_end );
+      } catch ( ... ) {
+        unique_lock<mutex> error_lock { batch.error_mutex };
+        if ( not batch.error ) {
+          batch.error = current_exception();
+        }
+      }
+
+      /* decrement under the lock, so the caller can't return (and destroy the batch) before we're done with it */
+      unique_lock<mutex> done_lock { batch.done_mutex };
+      if ( --batch.remaining == 0 ) {
+        batch.done.notify_all();
+      }
+    } );
+  }
+
+  {
+    unique_lock<mutex> lock { sleep_mutex_ };
+  }
+  wakeup_.notify_all();
+
+  /* help out until the batch is finished */
+  while ( batch.remaining > 0 ) {
+    if ( not run_one( first_queue ) ) {
+      unique_lock<mutex> lock { batch.done_mutex };
+      batch.done.wait( lock, [&] { return batch.remaining == 0; } );
+    }
+  }
+
+  /* wait for the last task to release the batch */
+  unique_lock<mutex> lock { batch.done_mutex };
+
+  if ( batch.error ) {
+    rethrow_exception( batch.error );
+  }
+}
+
+namespace {
+
+mutex shared_pool_mutex;
+unique_ptr<ThreadPool> shared_pool;
+
+/* rows per band so that each band starts on a cache line, given the row length in bytes,
+   and big enough that a band is worth handing to another thread */
+unsigned int band_rows( const unsigned int row_bytes )
+{
+  constexpr unsigned int MIN_BAND_ROWS = 8;
+
+  const unsigned int aligned_rows = 64 / gcd( row_bytes, 64u );
+  return aligned_rows * ( ( MIN_BAND_ROWS + aligned_rows - 1 ) / aligned_rows );
+}
+
+}
+
+ThreadPool& ThreadPool::shared()
+{
+  unique_lock<mutex> lock { shared_pool_mutex };
+
+  if ( not shared_pool ) {
+    shared_pool = make_unique<ThreadPool>();
+  }
+
+  return *shared_pool;
+}
+
+void ThreadPool::set_shared_thread_count( const unsigned int thread_count )
+{
+  unique_lock<mutex> lock { shared_pool_mutex };
+
+  shared_pool.reset();
+  shared_pool = make_unique<ThreadPool>( thread_count );
+}
+
+void parallel_for_bands( const Plane& plane, const ThreadPool::Range& body, ThreadPool& pool )
+{
+  pool.parallel_for( 0, plane.height(), body, band_rows( plane.stride() ) );
+}
+
+void parallel_for_bands( const Raster420& raster, const ThreadPool::Range& body, ThreadPool& pool )
+{
+  /* work in units of row pairs; the chroma row is the shorter, so it sets the alignment */
+  const unsigned int height = raster.Y.height();
+
+  pool.parallel_for(
+    0,
+    ( height + 1 ) / 2,
+    [&]( const unsigned int first_pair, const unsigned int end_pair ) {
+      body( 2 * first_pair, min( height, 2 * end_pair ) );
+    },
+    band_rows( raster.Cb.stride() ) );
+}
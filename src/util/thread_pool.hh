@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "raster.hh"
+
+/* Persistent pool of worker threads for data-parallel raster work.
+
+   Each worker has its own queue; an idle worker takes from the back of its own queue
+   and steals from the front of the others'. The thread that calls parallel_for()
+   counts as one of the pool's threads and works on the batch until it completes. */
+
+class ThreadPool
+{
+public:
+  using Range = std::function<void( const unsigned int begin, const unsigned int end )>;
+
+private:
+  struct alignas( 64 ) WorkQueue
+  {
+    std::mutex mutex {};
+    std::deque<std::function<void()>> tasks {};
+  };
+
+  std::vector<WorkQueue> queues_;
+  std::vector<std::thread> workers_ {};
+
+  std::atomic<unsigned int> queued_ { 0 };
+  std::atomic<unsigned int> next_queue_ { 0 };
+
+  std::mutex sleep_mutex_ {};
+  std::condition_variable wakeup_ {};
+  bool shutting_down_ = false;
+
+  bool run_one( const unsigned int preferred_queue );
+  void work( const unsigned int index );
+
+public:
+  explicit ThreadPool( const unsigned int thread_count = std::thread::hardware_concurrency() );
+  ~ThreadPool();
+
+  unsigned int thread_count() const { return workers_.size() + 1; }
+
+  /* run body( b, e ) over subranges of [begin, end), each a multiple of `grain` long
+     (except the last), and return when all have finished */
+  void parallel_for( const unsigned int begin, const unsigned int end, const Range& body, const unsigned int grain = 1 );
+
+  /* process-wide pool used by the raster and conversion routines */
+  static ThreadPool& shared();
+
+  /* replace the shared pool; must not be called while it is in use */
+  static void set_shared_thread_count( const unsigned int thread_count );
+
+  /* forbid copy */
+  ThreadPool( const ThreadPool& other ) = delete;
+  ThreadPool& operator=( const ThreadPool& other ) = delete;
+};
+
+/* Run body( first_row, end_row ) over horizontal bands of a plane or 4:2:0 raster.
+
+   Bands start on 64-byte boundaries in every plane so that no two threads write to the
+   same cache line, and (for Raster420) hold whole row pairs so each band owns its chroma rows. */
+void parallel_for_bands( const Plane& plane, const ThreadPool::Range& body, ThreadPool& pool = ThreadPool::shared() );
+void parallel_for_bands( const Raster420& raster,
+                         const ThreadPool::Range& body,
+                         ThreadPool& pool = ThreadPool::shared() );
@@ -0,0 +1,213 @@
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "y4m.hh"
+
+using namespace std;
+
+namespace {
+
+const size_t page_size = sysconf( _SC_PAGESIZE );
+
+/* the page-aligned range covering [first, first + length) */
+pair<uint8_t*, size_t> whole_pages( const uint8_t* first, const size_t length )
+{
+  const uintptr_t start = reinterpret_cast<uintptr_t>( first ) & ~( page_size - 1 );
+  const uintptr_t end = reinterpret_cast<uintptr_t>( first ) + length;
+  return { reinterpret_cast<uint8_t*>( start ), end - start };
+}
+
+}
+
+Y4MReader::Y4MReader( const string& filename )
+  : fd_( open( filename.c_str(), O_RDONLY ) )
+  , data_( nullptr )
+  , size_( 0 )
+{
+  if ( fd_ < 0 ) {
+    throw runtime_error( filename + ": " + strerror( errno ) );
+  }
+
+  struct stat info;
+  if ( fstat( fd_, &info ) < 0 ) {
+    const string error = strerror( errno );
+    close( fd_ );
+    throw runtime_error( filename + ": " + error );
+  }
+  size_ = info.st_size;
+
+  void* mapping = size_ ? mmap( nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0 ) : MAP_FAILED;
+  if ( mapping == MAP_FAILED ) {
+    const string error = size_ ? strerror( errno ) : "empty file";
+    close( fd_ );
+    throw runtime_error( filename + ": " + error );
+  }
+  data_ = static_cast<const uint8_t*>( mapping );
+
+  /* frames are mostly read in order */
+  madvise( mapping, size_, MADV_SEQUENTIAL );
+
+  try {
+    parse_header();
+  } catch ( const exception& e ) {
+    munmap( mapping, size_ );
+    close( fd_ );
+    throw runtime_error( filename + ": " + e.what() );
+  }
+}
+
+Y4MReader::~Y4MReader()
+{
+  munmap( const_cast<uint8_t*>( data_ ), size_ );
+  close( fd_ );
+}
+
+void Y4MReader::parse_header()
+{
+  const uint8_t* const end = data_ + size_;
+
+  const auto line_end = [&]( const uint8_t* start ) {
+    const void* newline = memchr( start, '\n', end - start );
+    if ( not newline ) {
+      throw runtime_error( "unterminated Y4M header" );
+    }
+    return static_cast<const uint8_t*>( newline );
+  };
+
+  const uint8_t* header_end = line_end( data_ );
+  istringstream tokens { string( data_, header_end ) };
+
+  string token;
+  tokens >> token;
+  if ( token != "YUV4MPEG2" ) {
+    throw runtime_error( "not a YUV4MPEG2 file" );
+  }
+
+  string colorspace = "420";
+  while ( tokens >> token ) {
+    const string value = token.substr( 1 );
+    switch ( token.front() ) {
+      case 'W':
+        width_ = stoul( value );
+        break;
+      case 'H':
+        height_ = stoul( value );
+        break;
+      case 'F':
+        if ( sscanf( value.c_str(), "%u:%u", &frame_rate_numerator_, &frame_rate_denominator_ ) != 2 ) {
+          throw runtime_error( "bad Y4M frame rate: " + value );
+        }
+        break;
+      case 'C':
+        colorspace = value;
+        break;
+      default: /* interlacing, aspect ratio and comments don't affect how frames are read */
+        break;
+    }
+  }
+
+  if ( colorspace == "420p10" ) {
+    bit_depth_ = 10;
+  } else if ( colorspace == "420p12" ) {
+    bit_depth_ = 12;
+  } else if ( colorspace == "420p16" ) {
+    bit_depth_ = 16;
+  } else if ( colorspace != "420" and colorspace != "420jpeg" and colorspace != "420paldv"
+              and colorspace != "420mpeg2" ) {
+    throw runtime_error( "unsupported Y4M colorspace " + colorspace + " (only 4:2:0 is supported)" );
+  }
+
+  if ( width_ == 0 or height_ == 0 or width_ % 2 or height_ % 2 ) {
+    throw runtime_error( "unsupported Y4M dimensions " + to_string( width_ ) + "x" + to_string( height_ ) );
+  }
+
+  /* each frame is "FRAME" (perhaps with parameters) and a newline, then the samples;
+     an incomplete final frame is ignored */
+  const uint8_t* position = header_end + 1;
+  while ( size_t( end - position ) > 5 and memcmp( position, "FRAME", 5 ) == 0 ) {
+    const uint8_t* samples = line_end( position ) + 1;
+    if ( size_t( end - samples ) < frame_bytes() ) {
+      break;
+    }
+
+    frame_offsets_.push_back( samples - data_ );
+    position = samples + frame_bytes();
+  }
+}
+
+double Y4MReader::frame_rate() const
+{
+  return frame_rate_denominator_ ? double( frame_rate_numerator_ ) / frame_rate_denominator_ : 0;
+}
+
+ConstRaster420View Y4MReader::frame( const size_t index ) const
+{
+  if ( bit_depth_ != 8 ) {
+    throw runtime_error( "Y4MReader::frame: the video is " + to_string( bit_depth_ ) + "-bit (use frame16)" );
+  }
+
+  const uint8_t* Y = data_ + frame_offsets_.at( index );
+  const uint8_t* Cb = Y + size_t( width_ ) * height_;
+  const uint8_t* Cr = Cb + size_t( width_ / 2 ) * ( height_ / 2 );
+
+  return { { Y, width_, height_ }, { Cb, width_ / 2, height_ / 2 }, { Cr, width_ / 2, height_ / 2 } };
+}
+
+ConstRaster420View16 Y4MReader::frame16( const size_t index ) const
+{
+  if ( bit_depth_ == 8 ) {
+    throw runtime_error( "Y4MReader::frame16: the video is 8-bit (use frame)" );
+  }
+
+  const uint16_t* Y = reinterpret_cast<const uint16_t*>( data_ + frame_offsets_.at( index ) );
+  const uint16_t* Cb = Y + size_t( width_ ) * height_;
+  const uint16_t* Cr = Cb + size_t( width_ / 2 ) * ( height_ / 2 );
+
+  return { { Y, width_, height_ }, { Cb, width_ / 2, height_ / 2 }, { Cr, width_ / 2, height_ / 2 } };
+}
+
+void Y4MReader::prefetch( const size_t first, const size_t count ) const
+{
+  if ( first >= frame_count() or count == 0 ) {
+    return;
+  }
+
+  const size_t last = min( frame_count(), first + count ) - 1;
+  const uint8_t* start = data_ + frame_offsets_.at( first );
+  const auto pages = whole_pages( start, frame_offsets_.at( last ) + frame_bytes() - frame_offsets_.at( first ) );
+
+  madvise( pages.first, pages.second, MADV_WILLNEED );
+
+#ifdef MADV_POPULATE_READ
+  if ( madvise( pages.first, pages.second, MADV_POPULATE_READ ) == 0 ) {
+    return;
+  }
+#endif
+
+  /* older kernels: touch a byte of each page */
+  uint8_t sum = 0;
+  for ( size_t offset = 0; offset < pages.second; offset += page_size ) {
+    sum += pages.first[offset];
+  }
+  const volatile uint8_t sink = sum;
+  (void)sink;
+}
+
+void Y4MReader::release( const size_t index ) const
+{
+  /* only whole pages within the frame, so neighbouring frames are left alone */
+  const uintptr_t start = reinterpret_cast<uintptr_t>( data_ + frame_offsets_.at( index ) );
+  const uintptr_t end = start + frame_bytes();
+  const uintptr_t first_page = ( start + page_size - 1 ) & ~( page_size - 1 );
+  const uintptr_t end_page = end & ~( page_size - 1 );
+
+  if ( end_page > first_page ) {
+    madvise( reinterpret_cast<void*>( first_page ), end_page - first_page, MADV_DONTNEED );
+  }
+}
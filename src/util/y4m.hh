@@ -0,0 +1,61 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "raster.hh"
+
+/* Reader for YUV4MPEG2 (.y4m) files of 4:2:0 video, 8-bit or (C420p10, C420p12,
+   C420p16) deeper, stored as 16-bit little-endian samples.
+
+   The whole file is mapped into memory, and each frame is returned as views of the
+   mapping, so reading a frame copies nothing -- whatever its depth, a frame can go from
+   the file to a texture with no per-sample work on the CPU. Pages are brought in by prefetch()
+   (ideally on another thread, ahead of when they're needed) and can be dropped
+   from this process's mapping with release() once a frame has been consumed. */
+class Y4MReader
+{
+  int fd_;
+  const uint8_t* data_;
+  size_t size_;
+
+  unsigned int width_ = 0, height_ = 0, bit_depth_ = 8;
+  unsigned int frame_rate_numerator_ = 0, frame_rate_denominator_ = 1;
+
+  /* where each frame's Y plane starts */
+  std::vector<size_t> frame_offsets_ {};
+
+  size_t sample_bytes() const { return bit_depth_ > 8 ? 2 : 1; }
+  size_t frame_bytes() const { return size_t( width_ ) * height_ * 3 / 2 * sample_bytes(); }
+  void parse_header();
+
+public:
+  explicit Y4MReader( const std::string& filename );
+  ~Y4MReader();
+
+  unsigned int width() const { return width_; }
+  unsigned int height() const { return height_; }
+  unsigned int bit_depth() const { return bit_depth_; }
+  size_t frame_count() const { return frame_offsets_.size(); }
+
+  /* frames per second, or 0 if the file doesn't say */
+  double frame_rate() const;
+
+  /* frame() is for 8-bit files and frame16() for deeper ones. A 16-bit frame's samples
+     may be only byte-aligned in the mapping (after a header of any length), so they're
+     for handing to GL, which copes, not for reading through the pointers. (GL takes them
+     in host byte order, so this assumes a little-endian host.) */
+  ConstRaster420View frame( const size_t index ) const;
+  ConstRaster420View16 frame16( const size_t index ) const;
+
+  /* ask the kernel to read frames [first, first + count) into memory, and fault them into
+     the mapping so whoever reads them next won't have to */
+  void prefetch( const size_t first, const size_t count ) const;
+
+  /* drop a frame's pages from the mapping (they stay in the page cache) */
+  void release( const size_t index ) const;
+
+  /* forbid copy */
+  Y4MReader( const Y4MReader& other ) = delete;
+  Y4MReader& operator=( const Y4MReader& other ) = delete;
+};
@@ -0,0 +1,222 @@
+#include <stdexcept>
+
+#include "ycbcr.hh"
+#include "ycbcr_kernels.hh"
+
+using namespace std;
+using namespace ycbcr;
+
+namespace {
+
+inline uint8_t clamp_sample( const int32_t value )
+{
+  return value < 0 ? 0 : value > 255 ? 255 : value;
+}
+
+template<ColorMatrix matrix, ColorRange range>
+inline uint8_t luma( const uint8_t* px )
+{
+  constexpr colorimetry::ForwardCoefficients k = COEFFICIENTS<matrix, range>;
+  return clamp_sample( ( k.y_b * px[0] + k.y_g * px[1] + k.y_r * px[2] + k.y_bias ) >> SHIFT );
+}
+
+/* whole 2x2 blocks only */
+template<ColorMatrix matrix, ColorRange range>
+unsigned int convert_rows_scalar( const uint8_t* bgra0,
+                                  const uint8_t* bgra1,
+                                  uint8_t* Y0,
+                                  uint8_t* Y1,
+                                  uint8_t* Cb,
+                                  uint8_t* Cr,
+                                  const unsigned int width )
+{
+  constexpr colorimetry::ForwardCoefficients k = COEFFICIENTS<matrix, range>;
+
+  unsigned int x = 0;
+  for ( ; x + 2 <= width; x += 2 ) {
+    const uint8_t* top = bgra0 + 4 * x;
+    const uint8_t* bottom = bgra1 + 4 * x;
+
+    Y0[x] = luma<matrix, range>( top );
+    Y0[x + 1] = luma<matrix, range>( top + 4 );
+    Y1[x] = luma<matrix, range>( bottom );
+    Y1[x + 1] = luma<matrix, range>( bottom + 4 );
+
+    const int32_t blue = top[0] + top[4] + bottom[0] + bottom[4];
+    const int32_t green = top[1] + top[5] + bottom[1] + bottom[5];
+    const int32_t red = top[2] + top[6] + bottom[2] + bottom[6];
+
+    Cb[x / 2] = clamp_sample( ( k.cb_b * blue + k.cb_g * green + k.cb_r * red + k.c_bias ) >> ( SHIFT + 2 ) );
+    Cr[x / 2] = clamp_sample( ( k.cr_b * blue + k.cr_g * green + k.cr_r * red + k.c_bias ) >> ( SHIFT + 2 ) );
+  }
+
+  return x;
+}
+
+RowPairKernel row_pair_kernel( const YCbCrKernel kernel, const Colorimetry colorimetry )
+{
+  if ( not ycbcr_kernel_supported( kernel ) ) {
+    throw runtime_error( "Y'CbCr conversion kernel not supported on this CPU: " + ycbcr_kernel_name( kernel ) );
+  }
+
+  switch ( kernel ) {
+    case YCbCrKernel::Scalar: {
+      static constexpr RowPairKernel kernels[] = { YCBCR_COLORIMETRY_VARIANTS( convert_rows_scalar ) };
+      return kernels[colorimetry.index()];
+    }
+    case YCbCrKernel::SSE41:
+      return sse41_kernel( colorimetry.index() );
+    case YCbCrKernel::AVX2:
+      return avx2_kernel( colorimetry.index() );
+    case YCbCrKernel::AVX512:
+      return avx512_kernel( colorimetry.index() );
+  }
+
+  throw runtime_error( "unknown Y'CbCr conversion kernel" );
+}
+
+/* rows [first_row, end_row) of columns [left, left + width), where first_row and left are even */
+template<ColorMatrix matrix, ColorRange range>
+void convert_band( const RowPairKernel convert_rows,
+                   const uint8_t* bgra,
+                   const ptrdiff_t stride,
+                   Raster420& output,
+                   const unsigned int first_row,
+                   const unsigned int end_row,
+                   const unsigned int left,
+                   const unsigned int width )
+{
+  bgra += 4 * left;
+
+  unsigned int y = first_row;
+  for ( ; y + 2 <= end_row; y += 2 ) {
+    const uint8_t* bgra0 = bgra + y * stride;
+    const uint8_t* bgra1 = bgra0 + stride;
+    uint8_t* Y0 = output.Y.mutable_row( y ) + left;
+    uint8_t* Y1 = output.Y.mutable_row( y + 1 ) + left;
+    uint8_t* Cb = output.Cb.mutable_row( y / 2 ) + left / 2;
+    uint8_t* Cr = output.Cr.mutable_row( y / 2 ) + left / 2;
+
+    unsigned int x = convert_rows( bgra0, bgra1, Y0, Y1, Cb, Cr, width );
+    x += convert_rows_scalar<matrix, range>( bgra0 + 4 * x, bgra1 + 4 * x, Y0 + x, Y1 + x, Cb + x / 2, Cr + x / 2, width - x );
+
+    /* odd width: the last column has no chroma of its own */
+    if ( x < width ) {
+      Y0[x] = luma<matrix, range>( bgra0 + 4 * x );
+      Y1[x] = luma<matrix, range>( bgra1 + 4 * x );
+    }
+  }
+
+  /* odd height: likewise for the last row */
+  if ( y < end_row ) {
+    uint8_t* Y0 = output.Y.mutable_row( y ) + left;
+    for ( unsigned int x = 0; x < width; x++ ) {
+      Y0[x] = luma<matrix, range>( bgra + y * stride + 4 * x );
+    }
+  }
+}
+
+using BandConverter = void ( * )( const RowPairKernel convert_rows,
+                                  const uint8_t* bgra,
+                                  const ptrdiff_t stride,
+                                  Raster420& output,
+                                  const unsigned int first_row,
+                                  const unsigned int end_row,
+                                  const unsigned int left,
+                                  const unsigned int width );
+
+BandConverter band_converter( const Colorimetry colorimetry )
+{
+  static constexpr BandConverter converters[] = { YCBCR_COLORIMETRY_VARIANTS( convert_band ) };
+  return converters[colorimetry.index()];
+}
+
+}
+
+bool ycbcr_kernel_supported( const YCbCrKernel kernel )
+{
+  __builtin_cpu_init();
+
+  switch ( kernel ) {
+    case YCbCrKernel::Scalar:
+      return true;
+    case YCbCrKernel::SSE41:
+      return __builtin_cpu_supports( "sse4.1" );
+    case YCbCrKernel::AVX2:
+      return __builtin_cpu_supports( "avx2" );
+    case YCbCrKernel::AVX512:
+      return __builtin_cpu_supports( "avx512f" ) and __builtin_cpu_supports( "avx512bw" );
+  }
+
+  return false;
+}
+
+YCbCrKernel ycbcr_best_kernel()
+{
+  static const YCbCrKernel best = [] {
+    for ( const auto kernel : { YCbCrKernel::AVX512, YCbCrKernel::AVX2, YCbCrKernel::SSE41 } ) {
+      if ( ycbcr_kernel_supported( kernel ) ) {
+        return kernel;
+      }
+    }
+    return YCbCrKernel::Scalar;
+  }();
+
+  return best;
+}
+
+string ycbcr_kernel_name( const YCbCrKernel kernel )
+{
+  switch ( kernel ) {
+    case YCbCrKernel::Scalar:
+      return "scalar";
+    case YCbCrKernel::SSE41:
+      return "SSE4.1";
+    case YCbCrKernel::AVX2:
+      return "AVX2";
+    case YCbCrKernel::AVX512:
+      return "AVX-512";
+  }
+
+  return "unknown";
+}
+
+void bgra_to_ycbcr420( const uint8_t* bgra,
+                       const ptrdiff_t stride,
+                       Raster420& output,
+                       const Colorimetry colorimetry,
+                       const YCbCrKernel kernel,
+                       ThreadPool& pool )
+{
+  const RowPairKernel convert_rows = row_pair_kernel( kernel, colorimetry );
+  const BandConverter convert = band_converter( colorimetry );
+
+  parallel_for_bands(
+    output,
+    [&]( const unsigned int first_row, const unsigned int end_row ) {
+      convert( convert_rows, bgra, stride, output, first_row, end_row, 0, output.Y.width() );
+    },
+    pool );
+}
+
+void bgra_to_ycbcr420_rect( const uint8_t* bgra,
+                            const ptrdiff_t stride,
+                            Raster420& output,
+                            const unsigned int x,
+                            const unsigned int y,
+                            const unsigned int width,
+                            const unsigned int height,
+                            const Colorimetry colorimetry,
+                            const YCbCrKernel kernel )
+{
+  if ( x % 2 or y % 2 ) {
+    throw runtime_error( "bgra_to_ycbcr420_rect: rectangle must start at an even position" );
+  }
+
+  if ( x > output.Y.width() or width > output.Y.width() - x or y > output.Y.height()
+       or height > output.Y.height() - y ) {
+    throw out_of_range( "bgra_to_ycbcr420_rect: rectangle extends outside raster" );
+  }
+
+  band_converter( colorimetry )( row_pair_kernel( kernel, colorimetry ), bgra, stride, output, y, y + height, x, width );
+}
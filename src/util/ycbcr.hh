@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "colorimetry.hh"
+#include "raster.hh"
+#include "thread_pool.hh"
+
+/* Conversion of BGRA images (e.g. a Cairo RGB24/ARGB32 surface) to 4:2:0 Y'CbCr.
+
+   Luma is computed for every pixel and chroma from the average of each 2x2 block,
+   all in integer fixed point, with the matrix and range of the given colorimetry. The
+   vectorized kernels produce results identical to the scalar one; the best one the CPU
+   supports is chosen at runtime. */
+
+enum class YCbCrKernel
+{
+  Scalar,
+  SSE41,
+  AVX2,
+  AVX512
+};
+
+bool ycbcr_kernel_supported( const YCbCrKernel kernel );
+YCbCrKernel ycbcr_best_kernel();
+std::string ycbcr_kernel_name( const YCbCrKernel kernel );
+
+/* `stride` is in bytes, and negative for an image stored bottom row first (pass a pointer
+   to its top row); `output` sets the dimensions of the conversion.
+   Bands of row pairs are converted in parallel on `pool`. */
+void bgra_to_ycbcr420( const uint8_t* bgra,
+                       const ptrdiff_t stride,
+                       Raster420& output,
+                       const Colorimetry colorimetry = {},
+                       const YCbCrKernel kernel = ycbcr_best_kernel(),
+                       ThreadPool& pool = ThreadPool::shared() );
+
+/* Convert just one rectangle of the image, into the same place in `output`, on the
+   calling thread (it's meant for small damaged regions). It must start at an even
+   position; an odd width or height only gets luma in its last column or row. */
+void bgra_to_ycbcr420_rect( const uint8_t* bgra,
+                            const ptrdiff_t stride,
+                            Raster420& output,
+                            const unsigned int x,
+                            const unsigned int y,
+                            const unsigned int width,
+                            const unsigned int height,
+                            const Colorimetry colorimetry = {},
+                            const YCbCrKernel kernel = ycbcr_best_kernel() );
@@ -0,0 +1,101 @@
+#pragma GCC target( "avx2" )
+
+#include <immintrin.h>
+
+#include "ycbcr_kernels.hh"
+
+using namespace ycbcr;
+
+/* Same arithmetic as the SSE4.1 kernel, two 128-bit lanes at a time. The pixels are widened
+   with in-lane unpacks, so every intermediate stays within its lane and the results only
+   need one shuffle back into raster order at the end. */
+
+namespace {
+
+inline __m256i weigh4( const __m256i px01, const __m256i px23, const __m256i coefficients )
+{
+  return _mm256_hadd_epi32( _mm256_madd_epi16( px01, coefficients ), _mm256_madd_epi16( px23, coefficients ) );
+}
+
+inline __m256i coefficients( const int16_t b, const int16_t g, const int16_t r )
+{
+  return _mm256_setr_epi16( b, g, r, 0, b, g, r, 0, b, g, r, 0, b, g, r, 0 );
+}
+
+inline __m256i luma4( const __m256i px01, const __m256i px23, const __m256i coefficients, const __m256i bias )
+{
+  return _mm256_srai_epi32( _mm256_add_epi32( weigh4( px01, px23, coefficients ), bias ), SHIFT );
+}
+
+inline __m256i chroma4( const __m256i sums[4], const __m256i coefficients, const __m256i bias )
+{
+  const __m256i columns = _mm256_hadd_epi32( weigh4( sums[0], sums[1], coefficients ),
+                                             weigh4( sums[2], sums[3], coefficients ) );
+  return _mm256_srai_epi32( _mm256_add_epi32( columns, bias ), SHIFT + 2 );
+}
+
+template<ColorMatrix matrix, ColorRange range>
+unsigned int convert_rows( const uint8_t* bgra0,
+                           const uint8_t* bgra1,
+                           uint8_t* Y0,
+                           uint8_t* Y1,
+                           uint8_t* Cb,
+                           uint8_t* Cr,
+                           const unsigned int width )
+{
+  constexpr unsigned int BLOCK = 16;
+  constexpr colorimetry::ForwardCoefficients k = COEFFICIENTS<matrix, range>;
+
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i y_coefficients = coefficients( k.y_b, k.y_g, k.y_r );
+  const __m256i cb_coefficients = coefficients( k.cb_b, k.cb_g, k.cb_r );
+  const __m256i cr_coefficients = coefficients( k.cr_b, k.cr_g, k.cr_r );
+  const __m256i y_bias = _mm256_set1_epi32( k.y_bias ), c_bias = _mm256_set1_epi32( k.c_bias );
+
+  /* lane-interleaved dwords -> raster order */
+  const __m256i luma_order = _mm256_setr_epi32( 0, 4, 1, 5, 2, 6, 3, 7 );
+  const __m128i chroma_order = _mm_setr_epi8( 0, 1, 8, 9, 2, 3, 10, 11, 4, 5, 12, 13, 6, 7, 14, 15 );
+
+  unsigned int x = 0;
+  for ( ; x + BLOCK <= width; x += BLOCK ) {
+    __m256i top[4], bottom[4], sums[4];
+
+    for ( unsigned int i = 0; i < 2; i++ ) {
+      const __m256i t = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( bgra0 + 4 * x ) + i );
+      const __m256i b = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( bgra1 + 4 * x ) + i );
+      top[2 * i] = _mm256_unpacklo_epi8( t, zero );
+      top[2 * i + 1] = _mm256_unpackhi_epi8( t, zero );
+      bottom[2 * i] = _mm256_unpacklo_epi8( b, zero );
+      bottom[2 * i + 1] = _mm256_unpackhi_epi8( b, zero );
+    }
+
+    for ( unsigned int i = 0; i < 4; i++ ) {
+      sums[i] = _mm256_add_epi16( top[i], bottom[i] );
+    }
+
+    const __m256i y_top = _mm256_packs_epi32( luma4( top[0], top[1], y_coefficients, y_bias ),
+                                              luma4( top[2], top[3], y_coefficients, y_bias ) );
+    const __m256i y_bottom = _mm256_packs_epi32( luma4( bottom[0], bottom[1], y_coefficients, y_bias ),
+                                                 luma4( bottom[2], bottom[3], y_coefficients, y_bias ) );
+    const __m256i y_bytes = _mm256_permutevar8x32_epi32( _mm256_packus_epi16( y_top, y_bottom ), luma_order );
+    _mm_storeu_si128( reinterpret_cast<__m128i*>( Y0 + x ), _mm256_castsi256_si128( y_bytes ) );
+    _mm_storeu_si128( reinterpret_cast<__m128i*>( Y1 + x ), _mm256_extracti128_si256( y_bytes, 1 ) );
+
+    const __m256i c
+      = _mm256_packs_epi32( chroma4( sums, cb_coefficients, c_bias ), chroma4( sums, cr_coefficients, c_bias ) );
+    const __m128i c_bytes = _mm_shuffle_epi8(
+      _mm_packus_epi16( _mm256_castsi256_si128( c ), _mm256_extracti128_si256( c, 1 ) ), chroma_order );
+    _mm_storel_epi64( reinterpret_cast<__m128i*>( Cb + x / 2 ), c_bytes );
+    _mm_storel_epi64( reinterpret_cast<__m128i*>( Cr + x / 2 ), _mm_srli_si128( c_bytes, 8 ) );
+  }
+
+  return x;
+}
+
+}
+
+RowPairKernel ycbcr::avx2_kernel( const unsigned int variant )
+{
+  static constexpr RowPairKernel kernels[] = { YCBCR_COLORIMETRY_VARIANTS( convert_rows ) };
+  return kernels[variant];
+}
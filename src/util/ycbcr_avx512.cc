@@ -0,0 +1,122 @@
+#pragma GCC target( "avx512f,avx512bw" )
+
+/* GCC 12's AVX-512 intrinsics trip -Wmaybe-uninitialized on their own placeholder operands (GCC bug 105593) */
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+#include <immintrin.h>
+
+#include "ycbcr_kernels.hh"
+
+using namespace ycbcr;
+
+/* Same arithmetic as the SSE4.1 kernel, four 128-bit lanes at a time. AVX-512 has no
+   horizontal add, so it is built from two-source permutes. */
+
+namespace {
+
+/* per-lane equivalent of _mm256_hadd_epi32 */
+inline __m512i hadd_lanes( const __m512i a, const __m512i b )
+{
+  const __m512i even = _mm512_setr_epi32( 0, 2, 16, 18, 4, 6, 20, 22, 8, 10, 24, 26, 12, 14, 28, 30 );
+  const __m512i odd = _mm512_setr_epi32( 1, 3, 17, 19, 5, 7, 21, 23, 9, 11, 25, 27, 13, 15, 29, 31 );
+  return _mm512_add_epi32( _mm512_permutex2var_epi32( a, even, b ), _mm512_permutex2var_epi32( a, odd, b ) );
+}
+
+/* sums of adjacent elements across the whole concatenation of a and b */
+inline __m512i hadd_across( const __m512i a, const __m512i b )
+{
+  const __m512i even = _mm512_setr_epi32( 0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30 );
+  const __m512i odd = _mm512_setr_epi32( 1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31 );
+  return _mm512_add_epi32( _mm512_permutex2var_epi32( a, even, b ), _mm512_permutex2var_epi32( a, odd, b ) );
+}
+
+inline __m512i weigh4( const __m512i px01, const __m512i px23, const __m512i coefficients )
+{
+  return hadd_lanes( _mm512_madd_epi16( px01, coefficients ), _mm512_madd_epi16( px23, coefficients ) );
+}
+
+inline __m512i coefficients( const int16_t b, const int16_t g, const int16_t r )
+{
+  return _mm512_set1_epi64( ( uint64_t( uint16_t( r ) ) << 32 ) | ( uint64_t( uint16_t( g ) ) << 16 )
+                            | uint64_t( uint16_t( b ) ) );
+}
+
+/* clamp to 0..255 and narrow */
+inline __m128i to_bytes( const __m512i x )
+{
+  return _mm512_cvtusepi32_epi8( _mm512_max_epi32( x, _mm512_setzero_si512() ) );
+}
+
+inline __m512i luma16( const __m512i px01, const __m512i px23, const __m512i coefficients, const __m512i bias )
+{
+  return _mm512_srai_epi32( _mm512_add_epi32( weigh4( px01, px23, coefficients ), bias ), SHIFT );
+}
+
+inline __m512i chroma16( const __m512i sums[4], const __m512i coefficients, const __m512i bias )
+{
+  const __m512i columns
+    = hadd_across( weigh4( sums[0], sums[1], coefficients ), weigh4( sums[2], sums[3], coefficients ) );
+  return _mm512_srai_epi32( _mm512_add_epi32( columns, bias ), SHIFT + 2 );
+}
+
+template<ColorMatrix matrix, ColorRange range>
+unsigned int convert_rows( const uint8_t* bgra0,
+                           const uint8_t* bgra1,
+                           uint8_t* Y0,
+                           uint8_t* Y1,
+                           uint8_t* Cb,
+                           uint8_t* Cr,
+                           const unsigned int width )
+{
+  constexpr unsigned int BLOCK = 32;
+  constexpr colorimetry::ForwardCoefficients k = COEFFICIENTS<matrix, range>;
+
+  const __m512i zero = _mm512_setzero_si512();
+  const __m512i y_coefficients = coefficients( k.y_b, k.y_g, k.y_r );
+  const __m512i cb_coefficients = coefficients( k.cb_b, k.cb_g, k.cb_r );
+  const __m512i cr_coefficients = coefficients( k.cr_b, k.cr_g, k.cr_r );
+  const __m512i y_bias = _mm512_set1_epi32( k.y_bias ), c_bias = _mm512_set1_epi32( k.c_bias );
+
+  unsigned int x = 0;
+  for ( ; x + BLOCK <= width; x += BLOCK ) {
+    __m512i top[4], bottom[4], sums[4];
+
+    for ( unsigned int i = 0; i < 2; i++ ) {
+      const __m512i t = _mm512_loadu_si512( bgra0 + 4 * x + 64 * i );
+      const __m512i b = _mm512_loadu_si512( bgra1 + 4 * x + 64 * i );
+      top[2 * i] = _mm512_unpacklo_epi8( t, zero );
+      top[2 * i + 1] = _mm512_unpackhi_epi8( t, zero );
+      bottom[2 * i] = _mm512_unpacklo_epi8( b, zero );
+      bottom[2 * i + 1] = _mm512_unpackhi_epi8( b, zero );
+    }
+
+    for ( unsigned int i = 0; i < 4; i++ ) {
+      sums[i] = _mm512_add_epi16( top[i], bottom[i] );
+    }
+
+    const __m512i y[4] = { luma16( top[0], top[1], y_coefficients, y_bias ),
+                           luma16( top[2], top[3], y_coefficients, y_bias ),
+                           luma16( bottom[0], bottom[1], y_coefficients, y_bias ),
+                           luma16( bottom[2], bottom[3], y_coefficients, y_bias ) };
+
+    _mm_storeu_si128( reinterpret_cast<__m128i*>( Y0 + x ), to_bytes( y[0] ) );
+    _mm_storeu_si128( reinterpret_cast<__m128i*>( Y0 + x + 16 ), to_bytes( y[1] ) );
+    _mm_storeu_si128( reinterpret_cast<__m128i*>( Y1 + x ), to_bytes( y[2] ) );
+    _mm_storeu_si128( reinterpret_cast<__m128i*>( Y1 + x + 16 ), to_bytes( y[3] ) );
+
+    _mm_storeu_si128( reinterpret_cast<__m128i*>( Cb + x / 2 ),
+                      to_bytes( chroma16( sums, cb_coefficients, c_bias ) ) );
+    _mm_storeu_si128( reinterpret_cast<__m128i*>( Cr + x / 2 ),
+                      to_bytes( chroma16( sums, cr_coefficients, c_bias ) ) );
+  }
+
+  return x;
+}
+
+}
+
+RowPairKernel ycbcr::avx512_kernel( const unsigned int variant )
+{
+  static constexpr RowPairKernel kernels[] = { YCBCR_COLORIMETRY_VARIANTS( convert_rows ) };
+  return kernels[variant];
+}
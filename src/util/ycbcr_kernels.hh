@@ -0,0 +1,54 @@
+#pragma once
+
+/* Internal interface between the BGRA -> Y'CbCr dispatcher (ycbcr.cc) and the
+   instruction-set-specific kernels (ycbcr_*.cc).
+
+   The kernel translation units are compiled with a "#pragma GCC target", so this
+   header must not pull in anything with inline functions (their out-of-line
+   copies could otherwise be emitted with instructions the CPU doesn't have).
+   colorimetry.hh is only used in constant expressions here. */
+
+#include <cstdint>
+
+#include "colorimetry.hh"
+
+namespace ycbcr {
+
+/* The conversion matrices come from colorimetry.hh, in 2.14 fixed point. Each kernel is
+   a template on the colorimetry, so the coefficients are compile-time constants, and every
+   variant is instantiated inside its own translation unit. */
+
+using colorimetry::SHIFT;
+
+template<ColorMatrix matrix, ColorRange range>
+constexpr colorimetry::ForwardCoefficients COEFFICIENTS = colorimetry::forward_coefficients( matrix, range );
+
+/* the instances of a kernel template, in colorimetry_index() order */
+#define YCBCR_COLORIMETRY_VARIANTS( kernel )                                                                           \
+  kernel<ColorMatrix::BT601, ColorRange::Limited>, kernel<ColorMatrix::BT601, ColorRange::Full>,                       \
+    kernel<ColorMatrix::BT709, ColorRange::Limited>, kernel<ColorMatrix::BT709, ColorRange::Full>,                     \
+    kernel<ColorMatrix::BT2020, ColorRange::Limited>, kernel<ColorMatrix::BT2020, ColorRange::Full>
+
+static_assert( colorimetry_index( ColorMatrix::BT601, ColorRange::Full ) == 1
+                 and colorimetry_index( ColorMatrix::BT709, ColorRange::Limited ) == 2
+                 and colorimetry_index( ColorMatrix::BT2020, ColorRange::Full ) == COLORIMETRY_VARIANTS - 1,
+               "YCBCR_COLORIMETRY_VARIANTS is out of order" );
+
+/* Each kernel converts a pair of BGRA rows into two rows of Y' and one row each of Cb and Cr.
+   It handles as many whole blocks of pixels as fit in `width` and returns the number of
+   pixels converted; the caller finishes the rest with the scalar code. */
+
+using RowPairKernel = unsigned int ( * )( const uint8_t* bgra0,
+                                          const uint8_t* bgra1,
+                                          uint8_t* Y0,
+                                          uint8_t* Y1,
+                                          uint8_t* Cb,
+                                          uint8_t* Cr,
+                                          const unsigned int width );
+
+/* the kernel for one colorimetry variant, by colorimetry_index() */
+RowPairKernel sse41_kernel( const unsigned int variant );
+RowPairKernel avx2_kernel( const unsigned int variant );
+RowPairKernel avx512_kernel( const unsigned int variant );
+
+}
@@ -0,0 +1,93 @@
+#pragma GCC target( "sse4.1" )
+
+#include <immintrin.h>
+
+#include "ycbcr_kernels.hh"
+
+using namespace ycbcr;
+
+namespace {
+
+/* 4 BGRA pixels (widened to 16 bits, two pixels per register) -> 4 x int32 weighted sums */
+inline __m128i weigh4( const __m128i px01, const __m128i px23, const __m128i coefficients )
+{
+  return _mm_hadd_epi32( _mm_madd_epi16( px01, coefficients ), _mm_madd_epi16( px23, coefficients ) );
+}
+
+inline __m128i coefficients( const int16_t b, const int16_t g, const int16_t r )
+{
+  return _mm_setr_epi16( b, g, r, 0, b, g, r, 0 );
+}
+
+inline __m128i luma4( const __m128i px01, const __m128i px23, const __m128i coefficients, const __m128i bias )
+{
+  return _mm_srai_epi32( _mm_add_epi32( weigh4( px01, px23, coefficients ), bias ), SHIFT );
+}
+
+/* column sums of 8 pixels -> 4 chroma samples */
+inline __m128i chroma4( const __m128i sums[4], const __m128i coefficients, const __m128i bias )
+{
+  const __m128i columns = _mm_hadd_epi32( weigh4( sums[0], sums[1], coefficients ),
+                                          weigh4( sums[2], sums[3], coefficients ) );
+  return _mm_srai_epi32( _mm_add_epi32( columns, bias ), SHIFT + 2 );
+}
+
+template<ColorMatrix matrix, ColorRange range>
+unsigned int convert_rows( const uint8_t* bgra0,
+                           const uint8_t* bgra1,
+                           uint8_t* Y0,
+                           uint8_t* Y1,
+                           uint8_t* Cb,
+                           uint8_t* Cr,
+                           const unsigned int width )
+{
+  constexpr unsigned int BLOCK = 8;
+  constexpr colorimetry::ForwardCoefficients k = COEFFICIENTS<matrix, range>;
+
+  const __m128i y_coefficients = coefficients( k.y_b, k.y_g, k.y_r );
+  const __m128i cb_coefficients = coefficients( k.cb_b, k.cb_g, k.cb_r );
+  const __m128i cr_coefficients = coefficients( k.cr_b, k.cr_g, k.cr_r );
+  const __m128i y_bias = _mm_set1_epi32( k.y_bias ), c_bias = _mm_set1_epi32( k.c_bias );
+
+  unsigned int x = 0;
+  for ( ; x + BLOCK <= width; x += BLOCK ) {
+    __m128i top[4], bottom[4], sums[4];
+
+    for ( unsigned int i = 0; i < 2; i++ ) {
+      const __m128i t = _mm_loadu_si128( reinterpret_cast<const __m128i*>( bgra0 + 4 * x ) + i );
+      const __m128i b = _mm_loadu_si128( reinterpret_cast<const __m128i*>( bgra1 + 4 * x ) + i );
+      top[2 * i] = _mm_cvtepu8_epi16( t );
+      top[2 * i + 1] = _mm_cvtepu8_epi16( _mm_srli_si128( t, 8 ) );
+      bottom[2 * i] = _mm_cvtepu8_epi16( b );
+      bottom[2 * i + 1] = _mm_cvtepu8_epi16( _mm_srli_si128( b, 8 ) );
+    }
+
+    for ( unsigned int i = 0; i < 4; i++ ) {
+      sums[i] = _mm_add_epi16( top[i], bottom[i] );
+    }
+
+    const __m128i y_top = _mm_packs_epi32( luma4( top[0], top[1], y_coefficients, y_bias ),
+                                           luma4( top[2], top[3], y_coefficients, y_bias ) );
+    const __m128i y_bottom = _mm_packs_epi32( luma4( bottom[0], bottom[1], y_coefficients, y_bias ),
+                                              luma4( bottom[2], bottom[3], y_coefficients, y_bias ) );
+    const __m128i y_bytes = _mm_packus_epi16( y_top, y_bottom );
+    _mm_storel_epi64( reinterpret_cast<__m128i*>( Y0 + x ), y_bytes );
+    _mm_storel_epi64( reinterpret_cast<__m128i*>( Y1 + x ), _mm_srli_si128( y_bytes, 8 ) );
+
+    const __m128i c
+      = _mm_packs_epi32( chroma4( sums, cb_coefficients, c_bias ), chroma4( sums, cr_coefficients, c_bias ) );
+    const __m128i c_bytes = _mm_packus_epi16( c, c );
+    _mm_storeu_si32( Cb + x / 2, c_bytes );
+    _mm_storeu_si32( Cr + x / 2, _mm_srli_si128( c_bytes, 4 ) );
+  }
+
+  return x;
+}
+
+}
+
+RowPairKernel ycbcr::sse41_kernel( const unsigned int variant )
+{
+  static constexpr RowPairKernel kernels[] = { YCBCR_COLORIMETRY_VARIANTS( convert_rows ) };
+  return kernels[variant];
+}